@@ -0,0 +1,491 @@
+/**********************************************************************************************
+*
+*   archive - compressed packs of mazes
+*
+*   LICENSE: zlib/libpng
+*
+*   Copyright (c) 2020 Jose Miguel Rodriguez Chavarri (https://github.com/txesmi/)
+*
+**********************************************************************************************/
+
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200112L // fseeko
+#endif
+
+#include "archive.h"
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+
+#define max(a, b) ((a) > (b) ? (a) : (b))
+
+#define ARCHIVE_PROB_BITS         11 // precision of the bit probabilities
+#define ARCHIVE_PROB_MOVE         4  // adaptation speed, higher is slower
+#define ARCHIVE_RANGE_TOP         (1u << 24)
+#define ARCHIVE_CONTEXTS          1024 // column and row parity, tile types of the cells on the left and above
+
+//--------------------------------------------------------------------------------------------
+// ENCODING
+//--------------------------------------------------------------------------------------------
+
+// Every maze starts with its bonuses, its starting cell and the way its tile types are
+// stored:
+// - coded, cell by cell with a binary range coder. Each type is coded as four bits down a
+//   tree whose probabilities adapt to the types of the cells on the left and above and to
+//   the parity of the cell, walls and corridors keeping to the odd and even lattice, so the
+//   cells a neighborhood makes likely, like walls between corridors or the inside of a
+//   room, take a small fraction of a bit.
+// - packed, the left cell of every pair in the low nibble, when coding would not shrink it.
+// The probabilities start over for every maze so each one is decoded alone.
+
+enum ArchiveModes
+{
+	ARCHIVE_PACKED = 0,
+	ARCHIVE_CODED
+};
+
+typedef struct
+{
+	unsigned short probs[ARCHIVE_CONTEXTS][16]; // probability of a 0 bit on each node of the tree
+} ARCHIVEMODEL;
+
+typedef struct
+{
+	unsigned long long low;
+	unsigned int range;
+	unsigned char cache; // last byte not written yet, a carry may still change it
+	unsigned long long cacheSize; // bytes pending, the cache and the 0xFF bytes following it
+	unsigned char *out;
+	unsigned char *limit;
+} ARCHIVEENCODER;
+
+typedef struct
+{
+	unsigned int code;
+	unsigned int range;
+	const unsigned char *in;
+	const unsigned char *last;
+	int overrun; // read past the data
+} ARCHIVEDECODER;
+
+static void ArchiveModelInit(ARCHIVEMODEL *_model)
+{
+	for (int _context = 0; _context < ARCHIVE_CONTEXTS; _context += 1)
+	{
+		for (int _node = 0; _node < 16; _node += 1)
+			_model->probs[_context][_node] = 1 << (ARCHIVE_PROB_BITS - 1);
+	}
+}
+
+static int ArchiveContext(const GRID *_grid, int _x, int _y, const unsigned char *_row)
+{
+	int _left = (_x > 0) ? _row[_x - 1] : CT_WALL;
+	int _up = (_y > 0) ? _row[_x - _grid->width] : CT_WALL;
+	return (((_x & 1) | ((_y & 1) << 1)) << 8) | (_left << 4) | _up;
+}
+
+static void ArchiveShiftLow(ARCHIVEENCODER *_encoder)
+{
+	if (((unsigned int)_encoder->low < 0xFF000000u) || ((_encoder->low >> 32) != 0))
+	{
+		unsigned char _carry = (unsigned char)(_encoder->low >> 32);
+		unsigned char _byte = _encoder->cache;
+		do
+		{
+			if (_encoder->out < _encoder->limit)
+				*_encoder->out = (unsigned char)(_byte + _carry);
+			_encoder->out += (_encoder->out < _encoder->limit) ? 1 : 0;
+			_byte = 0xFF;
+		}
+		while (--_encoder->cacheSize != 0);
+		_encoder->cache = (unsigned char)((unsigned int)_encoder->low >> 24);
+	}
+	_encoder->cacheSize += 1;
+	_encoder->low = (unsigned long long)((unsigned int)_encoder->low << 8);
+}
+
+static void ArchiveEncodeBit(ARCHIVEENCODER *_encoder, unsigned short *_prob, int _bit)
+{
+	unsigned int _bound = (_encoder->range >> ARCHIVE_PROB_BITS) * *_prob;
+	if (_bit == 0)
+	{
+		_encoder->range = _bound;
+		*_prob += ((1 << ARCHIVE_PROB_BITS) - *_prob) >> ARCHIVE_PROB_MOVE;
+	}
+	else
+	{
+		_encoder->low += _bound;
+		_encoder->range -= _bound;
+		*_prob -= *_prob >> ARCHIVE_PROB_MOVE;
+	}
+	while (_encoder->range < ARCHIVE_RANGE_TOP)
+	{
+		_encoder->range <<= 8;
+		ArchiveShiftLow(_encoder);
+	}
+}
+
+static int ArchiveDecodeBit(ARCHIVEDECODER *_decoder, unsigned short *_prob)
+{
+	unsigned int _bound = (_decoder->range >> ARCHIVE_PROB_BITS) * *_prob;
+	int _bit;
+	if (_decoder->code < _bound)
+	{
+		_decoder->range = _bound;
+		*_prob += ((1 << ARCHIVE_PROB_BITS) - *_prob) >> ARCHIVE_PROB_MOVE;
+		_bit = 0;
+	}
+	else
+	{
+		_decoder->code -= _bound;
+		_decoder->range -= _bound;
+		*_prob -= *_prob >> ARCHIVE_PROB_MOVE;
+		_bit = 1;
+	}
+	if (_decoder->range < ARCHIVE_RANGE_TOP)
+	{
+		_decoder->range <<= 8;
+		_decoder->overrun |= (_decoder->in == _decoder->last);
+		_decoder->code = (_decoder->code << 8) | ((_decoder->in < _decoder->last) ? *_decoder->in++ : 0);
+	}
+	return _bit;
+}
+
+// bytes of the coded types, 0 when they would not fit in _limit bytes
+static size_t ArchiveCode(const GRID *_grid, unsigned char *_data, size_t _limit)
+{
+	ARCHIVEMODEL _model;
+	ArchiveModelInit(&_model);
+	ARCHIVEENCODER _encoder = { 0, 0xFFFFFFFFu, 0, 1, _data, _data + _limit };
+
+	for (int _y = 0; _y < _grid->height; _y += 1)
+	{
+		const unsigned char *_row = _grid->types + GETCELL(_grid, 0, _y);
+		for (int _x = 0; _x < _grid->width; _x += 1)
+		{
+			unsigned short *_probs = _model.probs[ArchiveContext(_grid, _x, _y, _row)];
+			for (int _node = 1, _bit = 3; _bit >= 0; _bit -= 1)
+			{
+				int _value = (_row[_x] >> _bit) & 1;
+				ArchiveEncodeBit(&_encoder, _probs + _node, _value);
+				_node = (_node << 1) | _value;
+			}
+		}
+		if (_encoder.out == _encoder.limit)
+			return 0;
+	}
+	for (int _i = 0; _i < 5; _i += 1)
+		ArchiveShiftLow(&_encoder);
+	return (_encoder.out < _encoder.limit) ? (size_t)(_encoder.out - _data) : 0;
+}
+
+static int ArchiveUncode(const unsigned char *_data, size_t _bytes, GRID *_grid)
+{
+	if (_bytes < 5)
+		return 0;
+	ARCHIVEMODEL _model;
+	ArchiveModelInit(&_model);
+	ARCHIVEDECODER _decoder = { 0, 0xFFFFFFFFu, _data + 5, _data + _bytes, 0 };
+	for (int _i = 1; _i < 5; _i += 1)
+		_decoder.code = (_decoder.code << 8) | _data[_i];
+
+	for (int _y = 0; _y < _grid->height; _y += 1)
+	{
+		unsigned char *_row = _grid->types + GETCELL(_grid, 0, _y);
+		for (int _x = 0; _x < _grid->width; _x += 1)
+		{
+			unsigned short *_probs = _model.probs[ArchiveContext(_grid, _x, _y, _row)];
+			int _node = 1;
+			while (_node < 16)
+				_node = (_node << 1) | ArchiveDecodeBit(&_decoder, _probs + _node);
+			if (_node - 16 > CT_OPEN)
+				return 0;
+			_row[_x] = (unsigned char)(_node - 16);
+		}
+	}
+	return !_decoder.overrun && (_decoder.in == _decoder.last);
+}
+
+size_t ArchiveBound(int _width, int _height)
+{
+	return 2 * sizeof(int) + 1 + ((size_t)_width * (size_t)_height + 1) / 2;
+}
+
+size_t ArchiveEncode(const GRID *_grid, int _cellStart, unsigned char *_data)
+{
+	int _head[2] = { _grid->bonus, _cellStart };
+	memcpy(_data, _head, sizeof(_head));
+	unsigned char *_mode = _data + sizeof(_head);
+	size_t _packed = ((size_t)_grid->size + 1) / 2;
+
+	size_t _bytes = ArchiveCode(_grid, _mode + 1, _packed);
+	if (_bytes > 0)
+	{
+		*_mode = ARCHIVE_CODED;
+		return sizeof(_head) + 1 + _bytes;
+	}
+
+	*_mode = ARCHIVE_PACKED;
+	for (int _cell = 0; _cell < _grid->size; _cell += 2)
+	{
+		unsigned char _next = (_cell + 1 < _grid->size) ? _grid->types[_cell + 1] : 0;
+		_mode[1 + _cell / 2] = (unsigned char)((_grid->types[_cell] & 15) | (_next << 4));
+	}
+	return sizeof(_head) + 1 + _packed;
+}
+
+int ArchiveDecode(const unsigned char *_data, size_t _bytes, GRID *_grid, int *_cellStart)
+{
+	int _head[2];
+	if (_bytes < sizeof(_head) + 1)
+		return 0;
+	memcpy(_head, _data, sizeof(_head));
+	if ((_head[0] < 0) || (_head[1] < 0) || (_head[1] >= _grid->size))
+		return 0;
+	const unsigned char *_in = _data + sizeof(_head) + 1;
+	size_t _inBytes = _bytes - sizeof(_head) - 1;
+
+	if (_in[-1] == ARCHIVE_CODED)
+	{
+		if (!ArchiveUncode(_in, _inBytes, _grid))
+			return 0;
+	}
+	else if (_in[-1] == ARCHIVE_PACKED)
+	{
+		if (_inBytes != ((size_t)_grid->size + 1) / 2)
+			return 0;
+		for (int _cell = 0; _cell < _grid->size; _cell += 1)
+			_grid->types[_cell] = (_in[_cell / 2] >> (_cell % 2 * 4)) & 15;
+	}
+	else
+		return 0;
+	if (!GridTypesValid(_grid->width, _grid->height, _grid->types)) // floods must not leave the grid
+		return 0;
+
+	_grid->bonus = _head[0];
+	GridMasks(_grid);
+	memset(_grid->dists, 0, (size_t)_grid->size * sizeof(int));
+	memset(_grid->depths, 0, (size_t)_grid->size);
+	memset(_grid->stamps, 0, (size_t)_grid->size * sizeof(unsigned short));
+	_grid->stamp = 0;
+	if (_cellStart != NULL)
+		*_cellStart = _head[1];
+	return 1;
+}
+
+//--------------------------------------------------------------------------------------------
+// ARCHIVE
+//--------------------------------------------------------------------------------------------
+
+static int ArchiveSeek(FILE *_stream, unsigned long long _offset)
+{
+#ifdef _WIN32
+	return _fseeki64(_stream, (long long)_offset, SEEK_SET) == 0;
+#else
+	return fseeko(_stream, (off_t)_offset, SEEK_SET) == 0;
+#endif
+}
+
+static int ArchiveCompare(const MAZEID *_a, const MAZEID *_b)
+{
+	if (_a->seed != _b->seed)
+		return (_a->seed < _b->seed) ? -1 : 1;
+	if (_a->width != _b->width)
+		return (_a->width < _b->width) ? -1 : 1;
+	if (_a->height != _b->height)
+		return (_a->height < _b->height) ? -1 : 1;
+	if (_a->bonusMin != _b->bonusMin)
+		return (_a->bonusMin < _b->bonusMin) ? -1 : 1;
+	return 0;
+}
+
+static int ArchiveSort(const void *_a, const void *_b)
+{
+	return ArchiveCompare(&((const ARCHIVEENTRY*)_a)->id, &((const ARCHIVEENTRY*)_b)->id);
+}
+
+static int ArchiveReserve(ARCHIVE *_archive, size_t _bytes)
+{
+	if (_bytes <= _archive->dataBytes)
+		return 1;
+	unsigned char *_data = (unsigned char*)realloc(_archive->data, _bytes);
+	if (_data == NULL)
+		return 0;
+	_archive->data = _data;
+	_archive->dataBytes = _bytes;
+	return 1;
+}
+
+static void ArchiveFree(ARCHIVE *_archive)
+{
+	if (_archive->stream != NULL)
+		fclose(_archive->stream);
+	free(_archive->entries);
+	free(_archive->data);
+	free(_archive);
+}
+
+// the header is written last, an archive left unfinished is rejected when opened
+ARCHIVE *ArchiveCreate(const char *_path)
+{
+	ARCHIVE *_archive = (ARCHIVE*)calloc(1, sizeof(ARCHIVE));
+	if (_archive == NULL)
+		return NULL;
+	_archive->stream = fopen(_path, "wb");
+	ARCHIVEHEADER _header;
+	memset(&_header, 0, sizeof(_header));
+	if ((_archive->stream == NULL) || (fwrite(&_header, sizeof(_header), 1, _archive->stream) != 1))
+	{
+		ArchiveFree(_archive);
+		return NULL;
+	}
+	_archive->written = sizeof(_header);
+	return _archive;
+}
+
+int ArchiveAdd(ARCHIVE *_archive, const MAZEID *_id, const GRID *_grid, int _cellStart)
+{
+	if (_archive->count == _archive->capacity)
+	{
+		if (_archive->capacity > INT_MAX / 2)
+			return 0;
+		int _capacity = max(_archive->capacity * 2, 256);
+		ARCHIVEENTRY *_entries = (ARCHIVEENTRY*)realloc(_archive->entries, (size_t)_capacity * sizeof(ARCHIVEENTRY));
+		if (_entries == NULL)
+			return 0;
+		_archive->entries = _entries;
+		_archive->capacity = _capacity;
+	}
+	if (!ArchiveReserve(_archive, ArchiveBound(_grid->width, _grid->height)))
+		return 0;
+
+	size_t _bytes = ArchiveEncode(_grid, _cellStart, _archive->data);
+	if (fwrite(_archive->data, 1, _bytes, _archive->stream) != _bytes)
+		return 0;
+
+	ARCHIVEENTRY *_entry = _archive->entries + _archive->count;
+	memset(_entry, 0, sizeof(ARCHIVEENTRY));
+	_entry->id = *_id;
+	_entry->width = _grid->width;
+	_entry->height = _grid->height;
+	_entry->offset = _archive->written;
+	_entry->bytes = _bytes;
+	_archive->written += _bytes;
+	_archive->count += 1;
+	return 1;
+}
+
+int ArchiveFinish(ARCHIVE *_archive)
+{
+	if (_archive->count > 0)
+		qsort(_archive->entries, (size_t)_archive->count, sizeof(ARCHIVEENTRY), ArchiveSort);
+
+	ARCHIVEHEADER _header;
+	memset(&_header, 0, sizeof(_header));
+	memcpy(_header.magic, ARCHIVE_MAGIC, sizeof(_header.magic));
+	_header.version = ARCHIVE_VERSION;
+	_header.byteOrder = ARCHIVE_BYTE_ORDER;
+	_header.count = (unsigned int)_archive->count;
+	_header.indexOffset = _archive->written;
+
+	int _ok = ((_archive->count == 0) || (fwrite(_archive->entries, sizeof(ARCHIVEENTRY), (size_t)_archive->count, _archive->stream) == (size_t)_archive->count))
+		&& ArchiveSeek(_archive->stream, 0)
+		&& (fwrite(&_header, sizeof(_header), 1, _archive->stream) == 1);
+	if (fclose(_archive->stream) != 0)
+		_ok = 0;
+	_archive->stream = NULL;
+	ArchiveFree(_archive);
+	return _ok;
+}
+
+// the entries lie between the header and the index, sorted by ID
+static int ArchiveValid(const ARCHIVE *_archive, unsigned long long _indexOffset)
+{
+	for (int _i = 0; _i < _archive->count; _i += 1)
+	{
+		const ARCHIVEENTRY *_entry = _archive->entries + _i;
+		if ((_entry->width < 7) || (_entry->height < 7) || (_entry->width % 2 == 0) || (_entry->height % 2 == 0))
+			return 0;
+		if (_entry->width > INT_MAX / _entry->height)
+			return 0;
+		if ((_entry->offset < sizeof(ARCHIVEHEADER)) || (_entry->offset > _indexOffset) || (_indexOffset - _entry->offset < _entry->bytes))
+			return 0;
+		if (_entry->bytes > ArchiveBound(_entry->width, _entry->height))
+			return 0;
+		if ((_i > 0) && (ArchiveCompare(&_entry[-1].id, &_entry->id) > 0))
+			return 0;
+	}
+	return 1;
+}
+
+ARCHIVE *ArchiveOpen(const char *_path)
+{
+	ARCHIVE *_archive = (ARCHIVE*)calloc(1, sizeof(ARCHIVE));
+	if (_archive == NULL)
+		return NULL;
+	_archive->stream = fopen(_path, "rb");
+	ARCHIVEHEADER _header;
+	if ((_archive->stream == NULL) || (fread(&_header, sizeof(_header), 1, _archive->stream) != 1)
+		|| (memcmp(_header.magic, ARCHIVE_MAGIC, sizeof(_header.magic)) != 0)
+		|| (_header.version != ARCHIVE_VERSION) || (_header.byteOrder != ARCHIVE_BYTE_ORDER)
+		|| (_header.count > INT_MAX) || (_header.indexOffset < sizeof(_header)))
+	{
+		ArchiveFree(_archive);
+		return NULL;
+	}
+
+	_archive->count = (int)_header.count;
+	_archive->capacity = _archive->count;
+	_archive->entries = (ARCHIVEENTRY*)malloc(max((size_t)_archive->count, (size_t)1) * sizeof(ARCHIVEENTRY));
+	if ((_archive->entries == NULL) || !ArchiveSeek(_archive->stream, _header.indexOffset)
+		|| (fread(_archive->entries, sizeof(ARCHIVEENTRY), (size_t)_archive->count, _archive->stream) != (size_t)_archive->count)
+		|| !ArchiveValid(_archive, _header.indexOffset))
+	{
+		ArchiveFree(_archive);
+		return NULL;
+	}
+	return _archive;
+}
+
+void ArchiveClose(ARCHIVE *_archive)
+{
+	ArchiveFree(_archive);
+}
+
+int ArchiveFind(const ARCHIVE *_archive, const MAZEID *_id)
+{
+	int _low = 0;
+	int _high = _archive->count - 1;
+	while (_low <= _high)
+	{
+		int _mid = _low + (_high - _low) / 2;
+		int _order = ArchiveCompare(&_archive->entries[_mid].id, _id);
+		if (_order == 0)
+			return _mid;
+		if (_order < 0)
+			_low = _mid + 1;
+		else
+			_high = _mid - 1;
+	}
+	return -1;
+}
+
+GRID *ArchiveGrid(ARCHIVE *_archive, int _entry, int *_cellStart)
+{
+	if ((_entry < 0) || (_entry >= _archive->count))
+		return NULL;
+	const ARCHIVEENTRY *_item = _archive->entries + _entry;
+	if (!ArchiveReserve(_archive, (size_t)_item->bytes)
+		|| !ArchiveSeek(_archive->stream, _item->offset)
+		|| (fread(_archive->data, 1, (size_t)_item->bytes, _archive->stream) != (size_t)_item->bytes))
+		return NULL;
+
+	GRID *_grid = GridCreate(_item->width, _item->height);
+	if ((_grid != NULL) && !ArchiveDecode(_archive->data, (size_t)_item->bytes, _grid, _cellStart))
+	{
+		GridRemove(_grid);
+		return NULL;
+	}
+	return _grid;
+}
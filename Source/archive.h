@@ -0,0 +1,92 @@
+/**********************************************************************************************
+*
+*   archive - compressed packs of mazes
+*
+*   An archive holds many mazes in a single file, keeping only what can not be computed
+*   again: the tile types, the starting cell and the bonuses. The types are coded cell by
+*   cell with an adaptive binary range coder, whose probabilities depend on the types of the
+*   cells on the left and above and on the parity of the cell, so the walls and corridors of
+*   the maze lattice cost a fraction of a bit. A maze that would not shrink is stored packed,
+*   two cells per byte, instead.
+*
+*   An index sorted by maze ID closes the file. Opening an archive reads the header and the
+*   index only, and a maze is found by a binary search on its ID and decoded alone, so
+*   archives of millions of mazes are opened at once and cost the index in memory.
+*
+*   Decoded grids get their masks computed again from the types. Carve distances are not
+*   stored and decode as zero.
+*
+*   Archives are written in the byte order of the machine and rejected on another one.
+*
+*   LICENSE: zlib/libpng
+*
+*   Copyright (c) 2020 Jose Miguel Rodriguez Chavarri (https://github.com/txesmi/)
+*
+**********************************************************************************************/
+
+#ifndef ARCHIVE_H
+#define ARCHIVE_H
+
+#include "maze.h"
+#include <stdio.h>
+
+//--------------------------------------------------------------------------------------------
+// DEFINES
+//--------------------------------------------------------------------------------------------
+
+#define ARCHIVE_MAGIC             "MAZEPACK"
+#define ARCHIVE_VERSION           1
+#define ARCHIVE_BYTE_ORDER        0x01020304u
+
+//--------------------------------------------------------------------------------------------
+// ENCODING
+//--------------------------------------------------------------------------------------------
+
+size_t ArchiveBound(int _width, int _height); // most bytes ArchiveEncode writes for a grid of the size
+size_t ArchiveEncode(const GRID *_grid, int _cellStart, unsigned char *_data); // bytes written, _data holds ArchiveBound bytes
+int ArchiveDecode(const unsigned char *_data, size_t _bytes, GRID *_grid, int *_cellStart); // over a grid of the encoded size, 0 when the data is malformed
+
+//--------------------------------------------------------------------------------------------
+// ARCHIVE
+//--------------------------------------------------------------------------------------------
+
+typedef struct
+{
+	char magic[8];
+	unsigned int version;
+	unsigned int byteOrder; // ARCHIVE_BYTE_ORDER as written by the machine
+	unsigned int count; // mazes
+	unsigned int reserved;
+	unsigned long long indexOffset; // from the start of the file
+} ARCHIVEHEADER;
+
+typedef struct
+{
+	MAZEID id;
+	int width; // grid size
+	int height;
+	unsigned long long offset; // encoded maze from the start of the file
+	unsigned long long bytes;
+} ARCHIVEENTRY;
+
+typedef struct
+{
+	FILE *stream;
+	ARCHIVEENTRY *entries; // sorted by ID when read, in order of addition when written
+	int count;
+	int capacity;
+	unsigned char *data; // encoding buffer
+	size_t dataBytes;
+	unsigned long long written;
+} ARCHIVE;
+
+ARCHIVE *ArchiveCreate(const char *_path); // NULL when the file can not be created or out of memory
+int ArchiveAdd(ARCHIVE *_archive, const MAZEID *_id, const GRID *_grid, int _cellStart); // 0 on failure
+int ArchiveFinish(ARCHIVE *_archive); // writes the index and closes the archive, 0 on failure
+
+ARCHIVE *ArchiveOpen(const char *_path); // NULL when missing, truncated, or of another version or byte order
+void ArchiveClose(ARCHIVE *_archive);
+int ArchiveFind(const ARCHIVE *_archive, const MAZEID *_id); // entry of the maze, -1 when missing
+GRID *ArchiveGrid(ARCHIVE *_archive, int _entry, int *_cellStart); // decoded maze of the entry, NULL when out of memory or unreadable
+
+#endif // ARCHIVE_H
@@ -0,0 +1,303 @@
+/**********************************************************************************************
+*
+*   batch - parallel maze generation
+*
+*   LICENSE: zlib/libpng
+*
+*   Copyright (c) 2020 Jose Miguel Rodriguez Chavarri (https://github.com/txesmi/)
+*
+**********************************************************************************************/
+
+#include "batch.h"
+#include "thread.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define max(a, b) ((a) > (b) ? (a) : (b))
+#define min(a, b) ((a) < (b) ? (a) : (b))
+
+#define BATCH_WINDOW_PER_THREAD  4
+
+//--------------------------------------------------------------------------------------------
+// BATCH
+//--------------------------------------------------------------------------------------------
+
+typedef struct
+{
+	MUTEX *mutex;
+	int *chunks; // the owner pops the head, thieves take the tail
+	int head;
+	int tail;
+} BATCHQUEUE;
+
+typedef struct
+{
+	GRID *grid;
+	int cellStart;
+	int ready;
+} BATCHSLOT;
+
+typedef struct
+{
+	const BATCH *batch;
+	int threads;
+	int window;
+	int chunkJobs;
+	int chunkCount;
+	BATCHQUEUE *queues;
+	BATCHSLOT *slots; // window slots, job i waits in slot i % window
+	GRID **pool; // grids free to reuse
+	int poolCount;
+	MUTEX *mutex; // guards the slots, the pool and the fields below
+	COND *cond; // signaled when the window moves or the run fails
+	int next; // next job to emit
+	int emitting;
+	int failed;
+	int grids;
+	volatile int steals;
+} BATCHRUN;
+
+typedef struct
+{
+	BATCHRUN *run;
+	int index;
+} BATCHWORKER;
+
+static int BatchPop(BATCHRUN *_run, int _index)
+{
+	BATCHQUEUE *_queue = _run->queues + _index;
+	int _chunk = -1;
+	MutexLock(_queue->mutex);
+	if (_queue->head < _queue->tail)
+	{
+		_chunk = _queue->chunks[_queue->head];
+		_queue->head += 1;
+	}
+	MutexUnlock(_queue->mutex);
+	return _chunk;
+}
+
+static int BatchSteal(BATCHRUN *_run, int _index)
+{
+	for (int _i = 1; _i < _run->threads; _i += 1)
+	{
+		BATCHQUEUE *_queue = _run->queues + (_index + _i) % _run->threads;
+		int _chunk = -1;
+		MutexLock(_queue->mutex);
+		if (_queue->head < _queue->tail)
+		{
+			_queue->tail -= 1;
+			_chunk = _queue->chunks[_queue->tail];
+		}
+		MutexUnlock(_queue->mutex);
+		if (_chunk >= 0)
+		{
+			AtomicAdd(&_run->steals, 1);
+			return _chunk;
+		}
+	}
+	return -1;
+}
+
+// stores a finished maze and emits every maze in order from the next one, only one
+// thread emits at a time and it does without the lock
+static void BatchFinish(BATCHRUN *_run, int _job, GRID *_grid, int _cellStart)
+{
+	const BATCH *_batch = _run->batch;
+	MutexLock(_run->mutex);
+	BATCHSLOT *_slot = _run->slots + _job % _run->window;
+	_slot->grid = _grid;
+	_slot->cellStart = _cellStart;
+	_slot->ready = 1;
+
+	while (!_run->emitting && _run->slots[_run->next % _run->window].ready)
+	{
+		_slot = _run->slots + _run->next % _run->window;
+		_run->emitting = 1;
+		MutexUnlock(_run->mutex);
+
+		if (_batch->emit != NULL)
+		{
+			MAZEID _id = _batch->first;
+			_id.seed += (unsigned long long)_run->next;
+			_batch->emit(_batch->user, _run->next, &_id, _slot->grid, _slot->cellStart);
+		}
+
+		MutexLock(_run->mutex);
+		_run->pool[_run->poolCount] = _slot->grid;
+		_run->poolCount += 1;
+		_slot->grid = NULL;
+		_slot->ready = 0;
+		_run->next += 1;
+		_run->emitting = 0;
+		CondBroadcast(_run->cond);
+	}
+	MutexUnlock(_run->mutex);
+}
+
+static void BatchWorker(void *_data)
+{
+	BATCHWORKER *_worker = (BATCHWORKER*)_data;
+	BATCHRUN *_run = _worker->run;
+	const BATCH *_batch = _run->batch;
+
+	while (1)
+	{
+		int _chunk = BatchPop(_run, _worker->index);
+		if (_chunk < 0)
+			_chunk = BatchSteal(_run, _worker->index);
+		if (_chunk < 0)
+			return;
+
+		int _jobL = min((_chunk + 1) * _run->chunkJobs, _batch->count);
+		for (int _job = _chunk * _run->chunkJobs; _job < _jobL; _job += 1)
+		{
+			// wait for the window to reach the job and take a free grid
+			MutexLock(_run->mutex);
+			while ((_job >= _run->next + _run->window) && !_run->failed)
+				CondWait(_run->cond, _run->mutex);
+			GRID *_grid = NULL;
+			if (_run->poolCount > 0)
+			{
+				_run->poolCount -= 1;
+				_grid = _run->pool[_run->poolCount];
+			}
+			else
+				_run->grids += 1;
+			int _failed = _run->failed;
+			MutexUnlock(_run->mutex);
+			if (_failed)
+				return;
+
+			if (_grid == NULL)
+				_grid = GridCreate(_batch->first.width, _batch->first.height);
+			if (_grid == NULL)
+			{
+				MutexLock(_run->mutex);
+				_run->failed = 1;
+				CondBroadcast(_run->cond);
+				MutexUnlock(_run->mutex);
+				return;
+			}
+
+			// the same maze GridFromId builds for the job ID
+			GENERATOR _gen;
+			GeneratorInit(&_gen, _batch->first.seed + (unsigned long long)_job);
+			_gen.bonusMin = _batch->first.bonusMin;
+			int _cellStart = GridMaze(&_gen, _grid);
+
+			BatchFinish(_run, _job, _grid, _cellStart);
+		}
+	}
+}
+
+int BatchRun(const BATCH *_batch, BATCHSTATS *_stats)
+{
+	double _time = MazeTime();
+
+	BATCHRUN _run;
+	memset(&_run, 0, sizeof(_run));
+	_run.batch = _batch;
+	_run.threads = _batch->threads > 0 ? _batch->threads : ThreadHardwareCount();
+	_run.window = _batch->window > 0 ? _batch->window : _run.threads * BATCH_WINDOW_PER_THREAD;
+	_run.chunkJobs = max(_run.window / (2 * _run.threads), 1); // every worker keeps some chunks inside the window
+	_run.chunkCount = (_batch->count + _run.chunkJobs - 1) / _run.chunkJobs;
+
+	int _queueSize = (_run.chunkCount + _run.threads - 1) / _run.threads;
+	_run.queues = (BATCHQUEUE*)calloc((size_t)_run.threads, sizeof(BATCHQUEUE));
+	_run.slots = (BATCHSLOT*)calloc((size_t)_run.window, sizeof(BATCHSLOT));
+	_run.pool = (GRID**)calloc((size_t)(_run.window + _run.threads), sizeof(GRID*));
+	_run.mutex = MutexCreate();
+	_run.cond = CondCreate();
+	BATCHWORKER *_workers = (BATCHWORKER*)calloc((size_t)_run.threads, sizeof(BATCHWORKER));
+	THREAD **_handles = (THREAD**)calloc((size_t)_run.threads, sizeof(THREAD*));
+	int _failed = (_run.queues == NULL) || (_run.slots == NULL) || (_run.pool == NULL) || (_run.mutex == NULL) || (_run.cond == NULL) || (_workers == NULL) || (_handles == NULL);
+
+	// chunks are dealt round robin so every queue head stays near the emitted jobs
+	for (int _i = 0; (_i < _run.threads) && !_failed; _i += 1)
+	{
+		BATCHQUEUE *_queue = _run.queues + _i;
+		_queue->mutex = MutexCreate();
+		_queue->chunks = (int*)malloc((size_t)max(_queueSize, 1) * sizeof(int));
+		if ((_queue->mutex == NULL) || (_queue->chunks == NULL))
+		{
+			_failed = 1;
+			break;
+		}
+		for (int _chunk = _i; _chunk < _run.chunkCount; _chunk += _run.threads)
+		{
+			_queue->chunks[_queue->tail] = _chunk;
+			_queue->tail += 1;
+		}
+	}
+
+	if (!_failed)
+	{
+		// the calling thread is the first worker
+		for (int _i = 0; _i < _run.threads; _i += 1)
+		{
+			_workers[_i].run = &_run;
+			_workers[_i].index = _i;
+		}
+		for (int _i = 1; _i < _run.threads; _i += 1)
+		{
+			_handles[_i] = ThreadCreate(BatchWorker, _workers + _i);
+			if (_handles[_i] == NULL)
+			{
+				// nobody would pop the chunks of the missing worker before the window stalls
+				MutexLock(_run.mutex);
+				_run.failed = 1;
+				CondBroadcast(_run.cond);
+				MutexUnlock(_run.mutex);
+				break;
+			}
+		}
+		if (!_run.failed)
+			BatchWorker(_workers);
+		for (int _i = 1; _i < _run.threads; _i += 1)
+		{
+			if (_handles[_i] != NULL)
+				ThreadJoin(_handles[_i]);
+		}
+		_failed = _run.failed;
+	}
+
+	if (_stats != NULL)
+	{
+		_stats->seconds = MazeTime() - _time;
+		_stats->threads = _run.threads;
+		_stats->steals = _run.steals;
+		_stats->grids = _run.grids;
+	}
+
+	if (_run.slots != NULL)
+	{
+		for (int _i = 0; _i < _run.window; _i += 1)
+		{
+			if (_run.slots[_i].grid != NULL)
+				GridRemove(_run.slots[_i].grid);
+		}
+	}
+	for (int _i = 0; _i < _run.poolCount; _i += 1)
+		GridRemove(_run.pool[_i]);
+	if (_run.queues != NULL)
+	{
+		for (int _i = 0; _i < _run.threads; _i += 1)
+		{
+			if (_run.queues[_i].mutex != NULL)
+				MutexRemove(_run.queues[_i].mutex);
+			free(_run.queues[_i].chunks);
+		}
+	}
+	if (_run.mutex != NULL)
+		MutexRemove(_run.mutex);
+	if (_run.cond != NULL)
+		CondRemove(_run.cond);
+	free(_run.queues);
+	free(_run.slots);
+	free(_run.pool);
+	free(_workers);
+	free(_handles);
+
+	return !_failed;
+}
@@ -0,0 +1,47 @@
+/**********************************************************************************************
+*
+*   batch - parallel maze generation
+*
+*   Generates a run of mazes with consecutive seeds on a pool of worker threads. Every
+*   worker owns a queue of job chunks and steals chunks from the others when it runs out.
+*   Finished mazes go through a reorder window and are handed out in seed order, and their
+*   grids are reused by later jobs once the emit callback returns.
+*
+*   LICENSE: zlib/libpng
+*
+*   Copyright (c) 2020 Jose Miguel Rodriguez Chavarri (https://github.com/txesmi/)
+*
+**********************************************************************************************/
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "maze.h"
+
+//--------------------------------------------------------------------------------------------
+// BATCH
+//--------------------------------------------------------------------------------------------
+
+typedef void (*BATCHEMIT)(void *_user, int _index, const MAZEID *_id, GRID *_grid, int _cellStart);
+
+typedef struct
+{
+	MAZEID first; // maze of the first job, job i adds i to the seed
+	int count; // jobs
+	int threads; // <= 0 uses every core
+	int window; // finished mazes held back until the earlier ones are out, <= 0 for 4 per thread
+	BATCHEMIT emit; // called in job order, one call at a time, may be NULL
+	void *user;
+} BATCH;
+
+typedef struct
+{
+	double seconds;
+	int threads;
+	int steals; // chunks taken from the queue of another worker
+	int grids; // grids created, the rest of the jobs reused them
+} BATCHSTATS;
+
+int BatchRun(const BATCH *_batch, BATCHSTATS *_stats); // 0 when out of memory or out of threads, _stats may be NULL
+
+#endif // BATCH_H
@@ -0,0 +1,156 @@
+/**********************************************************************************************
+*
+*   frame - 32x32 frame composed on the CPU
+*
+*   LICENSE: zlib/libpng
+*
+*   Copyright (c) 2020 Jose Miguel Rodriguez Chavarri (https://github.com/txesmi/)
+*
+**********************************************************************************************/
+
+#include "frame.h"
+#include <stdlib.h>
+
+#define max(a, b) ((a) > (b) ? (a) : (b))
+#define min(a, b) ((a) < (b) ? (a) : (b))
+
+//--------------------------------------------------------------------------------------------
+// FRAME
+//--------------------------------------------------------------------------------------------
+
+static FRAMECOLOR FrameBlend(FRAMECOLOR _color, int _alpha, FRAMECOLOR _under)
+{
+	FRAMECOLOR _blend;
+	_blend.r = (unsigned char)((_color.r * _alpha + _under.r * (255 - _alpha)) / 255);
+	_blend.g = (unsigned char)((_color.g * _alpha + _under.g * (255 - _alpha)) / 255);
+	_blend.b = (unsigned char)((_color.b * _alpha + _under.b * (255 - _alpha)) / 255);
+	_blend.a = 255;
+	return _blend;
+}
+
+void FrameInit(FRAME *_frame, const FRAMECOLOR *_cellColors, FRAMECOLOR _background)
+{
+	_frame->background = _background;
+	for (int _type = 0; _type < FRAME_COLORS; _type += 1)
+	{
+		for (int _depth = 0; _depth <= MAZE_VISIBILITY_MAX; _depth += 1)
+			_frame->cells[_type][_depth] = FrameBlend(_cellColors[_type], 255 * _depth / MAZE_VISIBILITY_MAX, _background);
+	}
+	FrameClear(_frame);
+}
+
+void FrameClear(FRAME *_frame)
+{
+	for (int _i = 0; _i < FRAME_WIDTH * FRAME_HEIGHT; _i += 1)
+		_frame->pixels[_i] = _frame->background;
+}
+
+void FrameRect(FRAME *_frame, int _x, int _y, int _width, int _height, FRAMECOLOR _color)
+{
+	int _x0 = max(_x, 0);
+	int _xL = min(_x + _width, FRAME_WIDTH);
+	int _yL = min(_y + _height, FRAME_HEIGHT);
+	for (int _row = max(_y, 0); _row < _yL; _row += 1)
+	{
+		FRAMECOLOR *_pixel = _frame->pixels + _row * FRAME_WIDTH;
+		for (int _col = _x0; _col < _xL; _col += 1)
+			_pixel[_col] = (_color.a == 255) ? _color : FrameBlend(_color, _color.a, _pixel[_col]);
+	}
+}
+
+void FrameLine(FRAME *_frame, int _x0, int _y0, int _x1, int _y1, FRAMECOLOR _color)
+{
+	int _dx = abs(_x1 - _x0);
+	int _dy = -abs(_y1 - _y0);
+	int _stepX = (_x0 < _x1) ? 1 : -1;
+	int _stepY = (_y0 < _y1) ? 1 : -1;
+	int _error = _dx + _dy;
+	for (;;)
+	{
+		FrameRect(_frame, _x0, _y0, 1, 1, _color);
+		if ((_x0 == _x1) && (_y0 == _y1))
+			break;
+		int _error2 = _error * 2;
+		if (_error2 >= _dy)
+		{
+			_error += _dy;
+			_x0 += _stepX;
+		}
+		if (_error2 <= _dx)
+		{
+			_error += _dx;
+			_y0 += _stepY;
+		}
+	}
+}
+
+// rows of 3 bits from the top, the left pixel in the highest bit
+static unsigned short FrameGlyph(char _char)
+{
+	static const unsigned short _digits[10] =
+	{
+		0x7b6f, 0x2c97, 0x62a7, 0x628e, 0x5bc9, 0x798e, 0x39ef, 0x7292, 0x7bef, 0x7bce
+	};
+	static const unsigned short _letters[26] =
+	{
+		0x2bed, 0x6bae, 0x3923, 0x6b6e, 0x79a7, 0x79a4, 0x396b, 0x5bed, 0x7497, 0x126a, 0x5bad, 0x4927, 0x5fed,
+		0x6b6d, 0x2b6a, 0x6ba4, 0x2b73, 0x6bad, 0x388e, 0x7492, 0x5b6f, 0x5b6a, 0x5bfd, 0x5aad, 0x5a92, 0x72a7
+	};
+	if ((_char >= '0') && (_char <= '9'))
+		return _digits[_char - '0'];
+	if ((_char >= 'a') && (_char <= 'z'))
+		return _letters[_char - 'a'];
+	if ((_char >= 'A') && (_char <= 'Z'))
+		return _letters[_char - 'A'];
+	switch (_char)
+	{
+	case '-': return 0x01c0;
+	case '.': return 0x0002;
+	case ':': return 0x0410;
+	case '/': return 0x12a4;
+	case '%': return 0x52a5;
+	default: return 0;
+	}
+}
+
+void FrameText(FRAME *_frame, int _x, int _y, const char *_text, FRAMECOLOR _color)
+{
+	for (int _left = _x; *_text != '\0'; _text += 1)
+	{
+		if (*_text == '\n')
+		{
+			_x = _left;
+			_y += FRAME_FONT_LINE;
+			continue;
+		}
+		unsigned short _glyph = FrameGlyph(*_text);
+		for (int _bit = 0; _bit < FRAME_FONT_WIDTH * FRAME_FONT_HEIGHT; _bit += 1)
+		{
+			if (_glyph & (1 << (FRAME_FONT_WIDTH * FRAME_FONT_HEIGHT - 1 - _bit)))
+				FrameRect(_frame, _x + _bit % FRAME_FONT_WIDTH, _y + _bit / FRAME_FONT_WIDTH, 1, 1, _color);
+		}
+		_x += FRAME_FONT_ADVANCE;
+	}
+}
+
+void FrameMaze(FRAME *_frame, const GRID *_grid, int _cell)
+{
+	int _posX = CELLX(_grid, _cell);
+	int _posY = CELLY(_grid, _cell);
+	int _offX = 15 - _posX;
+	int _offY = 16 - _posY;
+	int _x0 = max(0, _posX - 15);
+	int _xL = min(_grid->width, _posX + 16);
+	int _yL = min(_grid->height, _posY + 16);
+	for (int _y = max(0, _posY - 16); _y < _yL; _y += 1)
+	{
+		const unsigned char *_types = _grid->types + GETCELL(_grid, 0, _y);
+		const signed char *_depths = _grid->depths + GETCELL(_grid, 0, _y);
+		FRAMECOLOR *_pixel = _frame->pixels + (_y + _offY) * FRAME_WIDTH + _offX;
+		for (int _x = _x0; _x < _xL; _x += 1)
+		{
+			if (_depths[_x] > 0)
+				_pixel[_x] = _frame->cells[min(_types[_x], CT_LAST_COLOR)][min(_depths[_x], MAZE_VISIBILITY_MAX)];
+		}
+	}
+}
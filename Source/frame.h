@@ -0,0 +1,61 @@
+/**********************************************************************************************
+*
+*   frame - 32x32 frame composed on the CPU
+*
+*   The screen of the game is small enough to be composed pixel by pixel into memory and
+*   uploaded as a whole, instead of a draw call per cell. Cell colors are looked up in a
+*   table of every tile type by every visibility depth, already faded over the background,
+*   built once when the frame is initialized.
+*
+*   Pixels are RGBA with the byte layout of a raylib Color, row by row from the top.
+*
+*   LICENSE: zlib/libpng
+*
+*   Copyright (c) 2020 Jose Miguel Rodriguez Chavarri (https://github.com/txesmi/)
+*
+**********************************************************************************************/
+
+#ifndef FRAME_H
+#define FRAME_H
+
+#include "maze.h"
+
+//--------------------------------------------------------------------------------------------
+// DEFINES
+//--------------------------------------------------------------------------------------------
+
+#define FRAME_WIDTH               32
+#define FRAME_HEIGHT              32
+#define FRAME_COLORS              (CT_LAST_COLOR + 1) // cell colors, corridors take the last one
+#define FRAME_FONT_WIDTH          3
+#define FRAME_FONT_HEIGHT         5
+#define FRAME_FONT_ADVANCE        (FRAME_FONT_WIDTH + 1)
+#define FRAME_FONT_LINE           (FRAME_FONT_HEIGHT + 1)
+
+//--------------------------------------------------------------------------------------------
+// FRAME
+//--------------------------------------------------------------------------------------------
+
+typedef struct
+{
+	unsigned char r;
+	unsigned char g;
+	unsigned char b;
+	unsigned char a;
+} FRAMECOLOR;
+
+typedef struct
+{
+	FRAMECOLOR pixels[FRAME_WIDTH * FRAME_HEIGHT];
+	FRAMECOLOR cells[FRAME_COLORS][MAZE_VISIBILITY_MAX + 1]; // by tile type and visibility depth
+	FRAMECOLOR background;
+} FRAME;
+
+void FrameInit(FRAME *_frame, const FRAMECOLOR *_cellColors, FRAMECOLOR _background); // _cellColors holds FRAME_COLORS colors, their alpha is ignored
+void FrameClear(FRAME *_frame); // fills the frame with the background
+void FrameRect(FRAME *_frame, int _x, int _y, int _width, int _height, FRAMECOLOR _color); // clipped to the frame, blended by the alpha of the color
+void FrameLine(FRAME *_frame, int _x0, int _y0, int _x1, int _y1, FRAMECOLOR _color); // both ends included
+void FrameText(FRAME *_frame, int _x, int _y, const char *_text, FRAMECOLOR _color); // 3x5 digits, letters of any case and - . : / %, lines split by \n
+void FrameMaze(FRAME *_frame, const GRID *_grid, int _cell); // visible cells around the viewer cell, the viewer at 15,16
+
+#endif // FRAME_H
@@ -0,0 +1,518 @@
+/**********************************************************************************************
+*
+*   headless - the raylib subset of the game without window, GPU or audio device
+*
+*   LICENSE: zlib/libpng
+*
+*   Copyright (c) 2020 Jose Miguel Rodriguez Chavarri (https://github.com/txesmi/)
+*
+**********************************************************************************************/
+
+#include "headless.h"
+#include "frame.h"
+#include "sink.h"
+#include <stdio.h>
+#include <string.h>
+
+#define max(a, b) ((a) > (b) ? (a) : (b))
+#define min(a, b) ((a) < (b) ? (a) : (b))
+
+#define HEADLESS_AUDIO_BUFFER     4096 // samples of each of the two buffers of a stream by default
+#define HEADLESS_DEMO             "none*10 up none*30 up*60 right*60 up*60 left*60 space none*10 down*60 right*60 escape none*10 " \
+                                  "right up none*30 up*60 left*60 up*60 right*60 escape none*10"
+
+//--------------------------------------------------------------------------------------------
+// HEADLESS
+//--------------------------------------------------------------------------------------------
+
+static const struct
+{
+	const char *name;
+	int key;
+} HeadlessKeyNames[] =
+{
+	{ "up", KEY_UP },
+	{ "down", KEY_DOWN },
+	{ "left", KEY_LEFT },
+	{ "right", KEY_RIGHT },
+	{ "space", KEY_SPACE },
+	{ "escape", KEY_ESCAPE },
+	{ "f3", KEY_F3 },
+};
+
+#define HEADLESS_KEYS             (int)(sizeof(HeadlessKeyNames) / sizeof(HeadlessKeyNames[0]))
+
+typedef struct
+{
+	unsigned int keys; // a bit per HeadlessKeyNames entry
+	int frames;
+} HEADLESSSTEP;
+
+typedef struct
+{
+	FRAMECOLOR *pixels;
+	int width;
+	int height;
+} HEADLESSTEXTURE;
+
+typedef struct
+{
+	FRAME frame;
+	bool textureMode; // drawing into the render texture, the frame
+	HEADLESSTEXTURE textures[HEADLESS_TEXTURES]; // by id - 1
+	SINK *sink; // receives the frames
+	HEADLESSSTEP *script;
+	int steps;
+	long long scriptFrames;
+	long long frames; // finished
+	long long frameMax;
+	unsigned int keys; // held on the current frame
+	unsigned int keysPrev;
+	int width;
+	int height;
+	double start;
+	int audioBuffer; // samples per buffer of the next stream
+	double audioQueued; // samples of the stream left to play
+	double audioRate;
+	bool audioPlaying;
+} HEADLESS;
+
+static HEADLESS gHeadless;
+
+static int HeadlessKeyBit(int _key)
+{
+	for (int _i = 0; _i < HEADLESS_KEYS; _i += 1)
+	{
+		if (HeadlessKeyNames[_i].key == _key)
+			return 1 << _i;
+	}
+	return 0;
+}
+
+static FRAMECOLOR HeadlessColor(Color _color)
+{
+	FRAMECOLOR _frameColor = { _color.r, _color.g, _color.b, _color.a };
+	return _frameColor;
+}
+
+// parses the input script, false when out of memory
+static bool HeadlessScript(const char *_text)
+{
+	gHeadless.steps = 0;
+	gHeadless.scriptFrames = 0;
+	gHeadless.script = (HEADLESSSTEP*)malloc((strlen(_text) / 2 + 1) * sizeof(HEADLESSSTEP)); // a token takes two characters at least
+	if (gHeadless.script == NULL)
+		return false;
+
+	while (*_text != '\0')
+	{
+		size_t _length = strcspn(_text, " \t\r\n");
+		if (_length == 0)
+		{
+			_text += 1;
+			continue;
+		}
+		HEADLESSSTEP _step = { 0, 1 };
+		const char *_end = _text + _length;
+		while (_text < _end)
+		{
+			size_t _name = strcspn(_text, "+* \t\r\n");
+			bool _known = (_name == 4) && (strncmp(_text, "none", 4) == 0);
+			for (int _i = 0; !_known && (_i < HEADLESS_KEYS); _i += 1)
+			{
+				if ((strlen(HeadlessKeyNames[_i].name) == _name) && (strncmp(_text, HeadlessKeyNames[_i].name, _name) == 0))
+				{
+					_step.keys |= 1u << _i;
+					_known = true;
+				}
+			}
+			if (!_known)
+				fprintf(stderr, "headless: unknown key '%.*s'\n", (int)_name, _text);
+			_text += _name;
+			if (*_text == '*')
+			{
+				_step.frames = max(atoi(_text + 1), 0);
+				_text = _end;
+			}
+			else if (*_text == '+')
+				_text += 1;
+		}
+		gHeadless.script[gHeadless.steps] = _step;
+		gHeadless.steps += 1;
+		gHeadless.scriptFrames += _step.frames;
+	}
+	return true;
+}
+
+// keys held on a frame, the script repeats
+static unsigned int HeadlessKeys(long long _frame)
+{
+	if (gHeadless.scriptFrames <= 0)
+		return 0;
+	_frame %= gHeadless.scriptFrames;
+	for (int _i = 0; _i < gHeadless.steps; _i += 1)
+	{
+		if (_frame < gHeadless.script[_i].frames)
+			return gHeadless.script[_i].keys;
+		_frame -= gHeadless.script[_i].frames;
+	}
+	return 0;
+}
+
+unsigned long long HeadlessSeed(unsigned long long _seed)
+{
+	const char *_text = getenv("MAZE_HEADLESS_SEED");
+	return (_text != NULL) ? strtoull(_text, NULL, 10) : _seed;
+}
+
+//--------------------------------------------------------------------------------------------
+// WINDOW
+//--------------------------------------------------------------------------------------------
+
+void SetTraceLogLevel(int _level)
+{
+	(void)_level;
+}
+
+void SetConfigFlags(unsigned int _flags)
+{
+	(void)_flags;
+}
+
+void InitWindow(int _width, int _height, const char *_title)
+{
+	(void)_title;
+	memset(&gHeadless, 0, sizeof(HEADLESS));
+	gHeadless.width = _width;
+	gHeadless.height = _height;
+	gHeadless.audioBuffer = HEADLESS_AUDIO_BUFFER;
+	gHeadless.frame.background = HeadlessColor(BLACK);
+	FrameClear(&gHeadless.frame);
+
+	const char *_input = getenv("MAZE_HEADLESS_INPUT");
+	if (!HeadlessScript((_input != NULL) ? _input : HEADLESS_DEMO))
+		fprintf(stderr, "headless: out of memory, no input\n");
+	const char *_frames = getenv("MAZE_HEADLESS_FRAMES");
+	gHeadless.frameMax = (_frames != NULL) ? strtoll(_frames, NULL, 10) : gHeadless.scriptFrames;
+	gHeadless.keys = HeadlessKeys(0);
+
+	const char *_output = getenv("MAZE_HEADLESS_OUTPUT");
+	const char *_format = getenv("MAZE_HEADLESS_FORMAT");
+	const char *_gamma = getenv("MAZE_HEADLESS_GAMMA");
+	const char *_brightness = getenv("MAZE_HEADLESS_BRIGHTNESS");
+	if (_output != NULL)
+	{
+		gHeadless.sink = SinkOpenDescriptor(_output, ((_format != NULL) && (strcmp(_format, "rgb") == 0)) ? SINK_RGB : SINK_PPM);
+		if (gHeadless.sink == NULL)
+			fprintf(stderr, "headless: out of memory, no frames written\n");
+		else
+			SinkLevels(gHeadless.sink, (_gamma != NULL) ? (float)atof(_gamma) : 1.0f, (_brightness != NULL) ? (float)atof(_brightness) : 1.0f);
+	}
+	gHeadless.start = MazeTime();
+}
+
+bool WindowShouldClose(void)
+{
+	return gHeadless.frames >= gHeadless.frameMax;
+}
+
+void CloseWindow(void)
+{
+	double _time = MazeTime() - gHeadless.start;
+	fprintf(stderr, "headless: %lld frames in %.3f s, %.0f frames/s\n",
+		gHeadless.frames, _time, _time > 0 ? (double)gHeadless.frames / _time : 0);
+	if (gHeadless.sink != NULL)
+	{
+		SINKSTATS _stats;
+		SinkClose(gHeadless.sink, &_stats);
+		SinkReport("headless", &_stats);
+	}
+	free(gHeadless.script);
+	for (int _i = 0; _i < HEADLESS_TEXTURES; _i += 1)
+		free(gHeadless.textures[_i].pixels);
+	memset(&gHeadless, 0, sizeof(HEADLESS));
+}
+
+int GetScreenWidth(void)
+{
+	return gHeadless.width;
+}
+
+int GetScreenHeight(void)
+{
+	return gHeadless.height;
+}
+
+void SetTargetFPS(int _fps)
+{
+	(void)_fps; // frames never wait
+}
+
+float GetFrameTime(void)
+{
+	return HEADLESS_FRAME_TIME;
+}
+
+void SetExitKey(int _key)
+{
+	(void)_key;
+}
+
+//--------------------------------------------------------------------------------------------
+// INPUT
+//--------------------------------------------------------------------------------------------
+
+bool IsKeyDown(int _key)
+{
+	return (gHeadless.keys & HeadlessKeyBit(_key)) != 0;
+}
+
+bool IsKeyPressed(int _key)
+{
+	return (gHeadless.keys & ~gHeadless.keysPrev & HeadlessKeyBit(_key)) != 0;
+}
+
+bool IsKeyReleased(int _key)
+{
+	return (~gHeadless.keys & gHeadless.keysPrev & HeadlessKeyBit(_key)) != 0;
+}
+
+//--------------------------------------------------------------------------------------------
+// TEXTURES
+//--------------------------------------------------------------------------------------------
+
+Image GenImageColor(int _width, int _height, Color _color)
+{
+	Image _image = { NULL, _width, _height, 1, 0 };
+	FRAMECOLOR *_pixels = (FRAMECOLOR*)malloc((size_t)_width * (size_t)_height * sizeof(FRAMECOLOR));
+	for (int _i = 0; (_pixels != NULL) && (_i < _width * _height); _i += 1)
+		_pixels[_i] = HeadlessColor(_color);
+	_image.data = _pixels;
+	return _image;
+}
+
+void UnloadImage(Image _image)
+{
+	free(_image.data);
+}
+
+Texture2D LoadTextureFromImage(Image _image)
+{
+	Texture2D _texture = { 0, _image.width, _image.height, 1, 0 };
+	for (int _i = 0; _i < HEADLESS_TEXTURES; _i += 1)
+	{
+		HEADLESSTEXTURE *_slot = gHeadless.textures + _i;
+		if (_slot->pixels != NULL)
+			continue;
+		size_t _bytes = (size_t)_image.width * (size_t)_image.height * sizeof(FRAMECOLOR);
+		_slot->pixels = (FRAMECOLOR*)malloc(_bytes);
+		if ((_slot->pixels == NULL) || (_image.data == NULL))
+			break;
+		memcpy(_slot->pixels, _image.data, _bytes);
+		_slot->width = _image.width;
+		_slot->height = _image.height;
+		_texture.id = (unsigned int)_i + 1;
+		break;
+	}
+	return _texture;
+}
+
+void UnloadTexture(Texture2D _texture)
+{
+	if ((_texture.id == 0) || (_texture.id > HEADLESS_TEXTURES))
+		return;
+	HEADLESSTEXTURE *_slot = gHeadless.textures + _texture.id - 1;
+	free(_slot->pixels);
+	memset(_slot, 0, sizeof(HEADLESSTEXTURE));
+}
+
+void UpdateTexture(Texture2D _texture, const void *_pixels)
+{
+	if ((_texture.id == 0) || (_texture.id > HEADLESS_TEXTURES) || (gHeadless.textures[_texture.id - 1].pixels == NULL))
+		return;
+	HEADLESSTEXTURE *_slot = gHeadless.textures + _texture.id - 1;
+	memcpy(_slot->pixels, _pixels, (size_t)_slot->width * (size_t)_slot->height * sizeof(FRAMECOLOR));
+}
+
+void SetTextureFilter(Texture2D _texture, int _filter)
+{
+	(void)_texture;
+	(void)_filter;
+}
+
+// the frame is the only render texture
+RenderTexture2D LoadRenderTexture(int _width, int _height)
+{
+	RenderTexture2D _target;
+	memset(&_target, 0, sizeof(RenderTexture2D));
+	_target.texture.width = _width;
+	_target.texture.height = _height;
+	return _target;
+}
+
+void UnloadRenderTexture(RenderTexture2D _target)
+{
+	(void)_target;
+}
+
+//--------------------------------------------------------------------------------------------
+// DRAWING
+//--------------------------------------------------------------------------------------------
+
+void BeginDrawing(void)
+{
+}
+
+void EndDrawing(void)
+{
+	if (gHeadless.sink != NULL)
+		SinkSubmit(gHeadless.sink, gHeadless.frame.pixels);
+	gHeadless.frames += 1;
+	if (gHeadless.audioPlaying)
+		gHeadless.audioQueued = max(gHeadless.audioQueued - gHeadless.audioRate * (double)HEADLESS_FRAME_TIME, 0.0);
+	gHeadless.keysPrev = gHeadless.keys;
+	gHeadless.keys = HeadlessKeys(gHeadless.frames);
+}
+
+void BeginTextureMode(RenderTexture2D _target)
+{
+	(void)_target;
+	gHeadless.textureMode = true;
+}
+
+void EndTextureMode(void)
+{
+	gHeadless.textureMode = false;
+}
+
+void ClearBackground(Color _color)
+{
+	if (gHeadless.textureMode)
+		FrameRect(&gHeadless.frame, 0, 0, FRAME_WIDTH, FRAME_HEIGHT, HeadlessColor(_color));
+}
+
+void DrawRectangle(int _x, int _y, int _width, int _height, Color _color)
+{
+	if (gHeadless.textureMode)
+		FrameRect(&gHeadless.frame, _x, _y, _width, _height, HeadlessColor(_color));
+}
+
+void DrawLine(int _x0, int _y0, int _x1, int _y1, Color _color)
+{
+	if (gHeadless.textureMode)
+		FrameLine(&gHeadless.frame, _x0, _y0, _x1, _y1, HeadlessColor(_color));
+}
+
+void DrawTexture(Texture2D _texture, int _x, int _y, Color _tint)
+{
+	(void)_tint;
+	if (!gHeadless.textureMode || (_texture.id == 0) || (_texture.id > HEADLESS_TEXTURES))
+		return;
+	const HEADLESSTEXTURE *_slot = gHeadless.textures + _texture.id - 1;
+	int _x0 = max(_x, 0);
+	int _xL = min(_x + _slot->width, FRAME_WIDTH);
+	int _yL = min(_y + _slot->height, FRAME_HEIGHT);
+	for (int _row = max(_y, 0); _row < _yL; _row += 1)
+	{
+		if (_xL > _x0)
+			memcpy(gHeadless.frame.pixels + _row * FRAME_WIDTH + _x0, _slot->pixels + (_row - _y) * _slot->width + (_x0 - _x), (size_t)(_xL - _x0) * sizeof(FRAMECOLOR));
+	}
+}
+
+void DrawTexturePro(Texture2D _texture, Rectangle _source, Rectangle _dest, Vector2 _origin, float _rotation, Color _tint)
+{
+	// the window is not there
+	(void)_texture;
+	(void)_source;
+	(void)_dest;
+	(void)_origin;
+	(void)_rotation;
+	(void)_tint;
+}
+
+Font GetFontDefault(void)
+{
+	Font _font = { FRAME_FONT_LINE };
+	return _font;
+}
+
+void DrawTextEx(Font _font, const char *_text, Vector2 _position, float _fontSize, float _spacing, Color _color)
+{
+	(void)_font;
+	(void)_fontSize;
+	(void)_spacing;
+	if (gHeadless.textureMode)
+		FrameText(&gHeadless.frame, (int)_position.x, (int)_position.y, _text, HeadlessColor(_color));
+}
+
+//--------------------------------------------------------------------------------------------
+// AUDIO
+//--------------------------------------------------------------------------------------------
+
+// the device is always ready, a single stream plays at a time
+
+void InitAudioDevice(void)
+{
+}
+
+void CloseAudioDevice(void)
+{
+}
+
+bool IsAudioDeviceReady(void)
+{
+	return true;
+}
+
+AudioStream InitAudioStream(unsigned int _sampleRate, unsigned int _sampleSize, unsigned int _channels)
+{
+	AudioStream _stream = { _sampleRate, _sampleSize, _channels };
+	gHeadless.audioRate = (double)_sampleRate;
+	gHeadless.audioQueued = 0;
+	gHeadless.audioPlaying = false;
+	return _stream;
+}
+
+void CloseAudioStream(AudioStream _stream)
+{
+	(void)_stream;
+	gHeadless.audioPlaying = false;
+}
+
+void UpdateAudioStream(AudioStream _stream, const void *_data, int _samples)
+{
+	(void)_stream;
+	(void)_data;
+	(void)_samples;
+	gHeadless.audioQueued += (double)gHeadless.audioBuffer;
+}
+
+bool IsAudioStreamProcessed(AudioStream _stream)
+{
+	(void)_stream;
+	return gHeadless.audioQueued <= (double)gHeadless.audioBuffer;
+}
+
+void PlayAudioStream(AudioStream _stream)
+{
+	(void)_stream;
+	gHeadless.audioPlaying = true;
+}
+
+void StopAudioStream(AudioStream _stream)
+{
+	(void)_stream;
+	gHeadless.audioPlaying = false;
+	gHeadless.audioQueued = 0;
+}
+
+bool IsAudioStreamPlaying(AudioStream _stream)
+{
+	(void)_stream;
+	return gHeadless.audioPlaying;
+}
+
+void SetAudioStreamBufferSizeDefault(int _size)
+{
+	gHeadless.audioBuffer = max(_size, 1);
+}
@@ -0,0 +1,153 @@
+/**********************************************************************************************
+*
+*   headless - the raylib subset of the game without window, GPU or audio device
+*
+*   Builds defining MAZE_HEADLESS include this header instead of raylib. Everything drawn into
+*   the render texture is rasterized into a 32x32 frame in memory and everything drawn on the
+*   window is dropped. Every EndDrawing submits the frame to a descriptor sink, see sink.h,
+*   and advances the input script one frame. Frames last a fixed 1/60 s and never wait for
+*   vsync, so a run measures the simulation and the rasterization alone. Audio streams are
+*   silent, but a playing one drains its two buffers at its sample rate on the frame clock, so
+*   whatever feeds it keeps the timing it has with a device.
+*
+*   The run is set up with environment variables:
+*   - MAZE_HEADLESS_OUTPUT, file or FIFO receiving the frames, - for the standard output,
+*     unix:path for a Unix stream socket. No frames are written without it.
+*   - MAZE_HEADLESS_FORMAT, ppm (default) for a binary PPM per frame, rgb for raw RGB bytes.
+*   - MAZE_HEADLESS_GAMMA and MAZE_HEADLESS_BRIGHTNESS, levels of the output, 1 by default.
+*     A LED panel usually wants a gamma around 2.2.
+*   - MAZE_HEADLESS_INPUT, keys held frame by frame: tokens separated by spaces, each one a
+*     list of keys joined by + and an optional *frames count, like "none*30 up right*90".
+*     Keys are up, down, left, right, space, escape, f3 and none. A demo script plays
+*     without it.
+*   - MAZE_HEADLESS_FRAMES, frames to run, the script repeating if shorter. The window
+*     closes at the end of the script without it.
+*   - MAZE_HEADLESS_SEED, seed of the game, see HeadlessSeed.
+*
+*   Closing the window reports the frames run and the frames per second on stderr, and the
+*   frames written and dropped by the sink and their latency.
+*
+*   LICENSE: zlib/libpng
+*
+*   Copyright (c) 2020 Jose Miguel Rodriguez Chavarri (https://github.com/txesmi/)
+*
+**********************************************************************************************/
+
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+//--------------------------------------------------------------------------------------------
+// DEFINES
+//--------------------------------------------------------------------------------------------
+
+#define HEADLESS_FRAME_TIME       (1.0f / 60.0f)
+#define HEADLESS_TEXTURES         8
+
+#ifndef PI
+#define PI                        3.14159265358979323846f
+#endif
+
+#define WHITE                     (Color) { 255, 255, 255, 255 }
+#define BLACK                     (Color) { 0, 0, 0, 255 }
+#define RED                       (Color) { 230, 41, 55, 255 }
+#define DARKGRAY                  (Color) { 80, 80, 80, 255 }
+
+enum HeadlessKeys
+{
+	KEY_SPACE = 32,
+	KEY_A = 65,
+	KEY_D = 68,
+	KEY_I = 73,
+	KEY_J = 74,
+	KEY_K = 75,
+	KEY_L = 76,
+	KEY_S = 83,
+	KEY_W = 87,
+	KEY_ESCAPE = 256,
+	KEY_F3 = 292,
+	KEY_RIGHT = 262,
+	KEY_LEFT = 263,
+	KEY_DOWN = 264,
+	KEY_UP = 265
+};
+
+enum HeadlessFlags
+{
+	LOG_WARNING = 4,
+	FLAG_WINDOW_UNDECORATED = 8,
+	FLAG_VSYNC_HINT = 64,
+	FILTER_POINT = 0
+};
+
+//--------------------------------------------------------------------------------------------
+// RAYLIB
+//--------------------------------------------------------------------------------------------
+
+typedef struct Color { unsigned char r, g, b, a; } Color;
+typedef struct Vector2 { float x, y; } Vector2;
+typedef struct Rectangle { float x, y, width, height; } Rectangle;
+typedef struct Image { void *data; int width, height, mipmaps, format; } Image;
+typedef struct Texture2D { unsigned int id; int width, height, mipmaps, format; } Texture2D;
+typedef struct RenderTexture2D { unsigned int id; Texture2D texture; Texture2D depth; bool depthTexture; } RenderTexture2D;
+typedef struct Font { int baseSize; } Font;
+typedef struct AudioStream { unsigned int sampleRate, sampleSize, channels; } AudioStream;
+
+void SetTraceLogLevel(int _level);
+void SetConfigFlags(unsigned int _flags);
+void InitWindow(int _width, int _height, const char *_title);
+bool WindowShouldClose(void);
+void CloseWindow(void);
+int GetScreenWidth(void);
+int GetScreenHeight(void);
+void SetTargetFPS(int _fps);
+float GetFrameTime(void);
+void SetExitKey(int _key);
+
+bool IsKeyDown(int _key);
+bool IsKeyPressed(int _key);
+bool IsKeyReleased(int _key);
+
+Image GenImageColor(int _width, int _height, Color _color);
+void UnloadImage(Image _image);
+Texture2D LoadTextureFromImage(Image _image);
+void UnloadTexture(Texture2D _texture);
+void UpdateTexture(Texture2D _texture, const void *_pixels);
+void SetTextureFilter(Texture2D _texture, int _filter);
+RenderTexture2D LoadRenderTexture(int _width, int _height);
+void UnloadRenderTexture(RenderTexture2D _target);
+
+void BeginDrawing(void);
+void EndDrawing(void); // writes the frame out
+void BeginTextureMode(RenderTexture2D _target);
+void EndTextureMode(void);
+void ClearBackground(Color _color);
+void DrawRectangle(int _x, int _y, int _width, int _height, Color _color);
+void DrawLine(int _x0, int _y0, int _x1, int _y1, Color _color);
+void DrawTexture(Texture2D _texture, int _x, int _y, Color _tint); // the tint is ignored
+void DrawTexturePro(Texture2D _texture, Rectangle _source, Rectangle _dest, Vector2 _origin, float _rotation, Color _tint);
+Font GetFontDefault(void); // the 3x5 font of the frame
+void DrawTextEx(Font _font, const char *_text, Vector2 _position, float _fontSize, float _spacing, Color _color);
+
+void InitAudioDevice(void);
+void CloseAudioDevice(void);
+bool IsAudioDeviceReady(void);
+AudioStream InitAudioStream(unsigned int _sampleRate, unsigned int _sampleSize, unsigned int _channels);
+void CloseAudioStream(AudioStream _stream);
+void UpdateAudioStream(AudioStream _stream, const void *_data, int _samples); // takes a whole buffer, like raylib
+bool IsAudioStreamProcessed(AudioStream _stream);
+void PlayAudioStream(AudioStream _stream);
+void StopAudioStream(AudioStream _stream);
+bool IsAudioStreamPlaying(AudioStream _stream);
+void SetAudioStreamBufferSizeDefault(int _size);
+
+//--------------------------------------------------------------------------------------------
+// HEADLESS
+//--------------------------------------------------------------------------------------------
+
+unsigned long long HeadlessSeed(unsigned long long _seed); // MAZE_HEADLESS_SEED when set, _seed otherwise
+
+#endif // HEADLESS_H
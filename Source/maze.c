@@ -0,0 +1,1393 @@
+/**********************************************************************************************
+*
+*   maze - headless maze core
+*
+*   LICENSE: zlib/libpng
+*
+*   Copyright (c) 2020 Jose Miguel Rodriguez Chavarri (https://github.com/txesmi/)
+*
+**********************************************************************************************/
+
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 199309L // clock_gettime
+#endif
+
+#include "maze.h"
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#if defined(_DEBUG) || defined(MAZE_VISIBILITY_CHECK)
+#include <stdio.h>
+#endif
+
+#define max(a, b) ((a) > (b) ? (a) : (b))
+#define min(a, b) ((a) < (b) ? (a) : (b))
+
+#define MAKEODD(x) ((int)(x) | 1)
+#define SIGN(x) ((x) < 1 ? -1 : 1)
+
+// every cell the visibility flood spreads from lies inside this chebyshev distance of the
+// viewer, since each step costs at least one depth unit, and each of them spreads once per
+// flood pushing its eight neighbors. An incremental flood also spreads once from each of
+// its seeds before it runs, up to FLOOD_SEEDS of them, more fall back to a full flood.
+#define FLOOD_REACH    (MAZE_VISIBILITY_MAX - MAZE_VISIBILITY_END)
+#define FLOOD_SEEDS    64
+#define FLOOD_ITEMS    (8 * (2 * FLOOD_REACH + 1) * (2 * FLOOD_REACH + 1) + 8 * FLOOD_SEEDS + 1)
+#define FLOOD_BUCKETS  (MAZE_VISIBILITY_MAX - MAZE_VISIBILITY_MIN + 1)
+
+#define PLANE_BITS     64 // cells of a bit plane word
+#define PLANE_COUNT    3  // walkable, walls or open, room centers
+
+#ifndef MAZE_TILE_BYTES
+#define MAZE_TILE_BYTES  (256 * 1024) // work layer rows the post-processing stages share in cache
+#endif
+#define MAZE_STAGE_LAG   2 // rows each stage runs behind the previous one
+
+static const int offsets4[4][2] = {
+	 1,  0,
+	 0, -1,
+	-1,  0,
+	 0,  1
+};
+
+static const int offsets8[8][2] = {
+	 1,  0,
+	 1, -1,
+	 0, -1,
+	-1, -1,
+	-1,  0,
+	-1,  1,
+	 0,  1,
+	 1,  1
+};
+
+//--------------------------------------------------------------------------------------------
+// GENERATOR
+//--------------------------------------------------------------------------------------------
+
+// xoshiro128** over a state expanded from the seed with splitmix64, bounded draws through
+// Lemire's multiply and shift without modulo bias
+
+static unsigned int GeneratorRotate(unsigned int _x, int _k)
+{
+	return (_x << _k) | (_x >> (32 - _k));
+}
+
+static unsigned long long GeneratorSplitMix(unsigned long long *_x)
+{
+	unsigned long long _z = (*_x += 0x9E3779B97F4A7C15ULL);
+	_z = (_z ^ (_z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	_z = (_z ^ (_z >> 27)) * 0x94D049BB133111EBULL;
+	return _z ^ (_z >> 31);
+}
+
+void GeneratorInit(GENERATOR *_gen, unsigned long long _seed)
+{
+	unsigned long long _x = _seed;
+	unsigned long long _a = GeneratorSplitMix(&_x);
+	unsigned long long _b = GeneratorSplitMix(&_x);
+	_gen->state[0] = (unsigned int)_a;
+	_gen->state[1] = (unsigned int)(_a >> 32);
+	_gen->state[2] = (unsigned int)_b;
+	_gen->state[3] = (unsigned int)(_b >> 32);
+	if ((_a | _b) == 0) // xoshiro state can not be zero
+		_gen->state[0] = 1;
+	_gen->bonusMin = 1;
+	_gen->stats = NULL;
+}
+
+void GeneratorStream(GENERATOR *_gen, unsigned long long _seed, int _stream)
+{
+	GeneratorInit(_gen, _seed);
+	for (int _i = 0; _i < _stream; _i += 1)
+		GeneratorJump(_gen);
+}
+
+void GeneratorJump(GENERATOR *_gen)
+{
+	static const unsigned int _jump[4] = { 0x8764000Bu, 0xF542D2D3u, 0x6FA035C3u, 0x77F2DB5Bu };
+	unsigned int _state[4] = { 0, 0, 0, 0 };
+	for (int _i = 0; _i < 4; _i += 1)
+	{
+		for (int _b = 0; _b < 32; _b += 1)
+		{
+			if (_jump[_i] & (1u << _b))
+			{
+				for (int _k = 0; _k < 4; _k += 1)
+					_state[_k] ^= _gen->state[_k];
+			}
+			GeneratorNext(_gen);
+		}
+	}
+	for (int _k = 0; _k < 4; _k += 1)
+		_gen->state[_k] = _state[_k];
+}
+
+unsigned int GeneratorNext(GENERATOR *_gen)
+{
+	unsigned int *_s = _gen->state;
+	unsigned int _result = GeneratorRotate(_s[1] * 5, 7) * 9;
+	unsigned int _t = _s[1] << 9;
+	_s[2] ^= _s[0];
+	_s[3] ^= _s[1];
+	_s[1] ^= _s[2];
+	_s[0] ^= _s[3];
+	_s[2] ^= _t;
+	_s[3] = GeneratorRotate(_s[3], 11);
+	return _result;
+}
+
+int GeneratorRandom(GENERATOR *_gen, int _min, int _max)
+{
+	if (_min > _max)
+	{
+		int _tmp = _max;
+		_max = _min;
+		_min = _tmp;
+	}
+
+	unsigned int _range = (unsigned int)_max - (unsigned int)_min + 1u; // 0 stands for the whole 32 bit range
+	if (_range == 0)
+		return (int)GeneratorNext(_gen);
+	unsigned long long _m = (unsigned long long)GeneratorNext(_gen) * _range;
+	if ((unsigned int)_m < _range)
+	{
+		unsigned int _threshold = (0u - _range) % _range;
+		while ((unsigned int)_m < _threshold)
+			_m = (unsigned long long)GeneratorNext(_gen) * _range;
+	}
+	return (int)((unsigned int)_min + (unsigned int)(_m >> 32));
+}
+
+// adds the time elapsed since _time to the pass and returns the current time
+static double GeneratorPass(GENERATOR *_gen, int _pass, double _time)
+{
+	if (_gen->stats == NULL)
+		return 0;
+	double _now = MazeTime();
+	if (_pass >= 0)
+		_gen->stats->passTime[_pass] += _now - _time;
+	return _now;
+}
+
+double MazeTime(void)
+{
+#ifdef _WIN32
+	LARGE_INTEGER _frequency, _counter;
+	QueryPerformanceFrequency(&_frequency);
+	QueryPerformanceCounter(&_counter);
+	return (double)_counter.QuadPart / (double)_frequency.QuadPart;
+#else
+	struct timespec _ts;
+	clock_gettime(CLOCK_MONOTONIC, &_ts);
+	return (double)_ts.tv_sec + (double)_ts.tv_nsec * 1e-9;
+#endif
+}
+
+//--------------------------------------------------------------------------------------------
+// GRID
+//--------------------------------------------------------------------------------------------
+
+
+// set array member offsets
+static void GridOffsets(GRID *_grid)
+{
+	for (int _dir = 0; _dir < 4; _dir += 1)
+	{
+		_grid->cellOffsets4[_dir] = offsets4[_dir][0] + offsets4[_dir][1] * _grid->width;
+		_grid->cellOffsets8[_dir] = offsets8[_dir][0] + offsets8[_dir][1] * _grid->width;
+	}
+	for (int _dir = 4; _dir < 8; _dir += 1)
+		_grid->cellOffsets8[_dir] = offsets8[_dir][0] + offsets8[_dir][1] * _grid->width;
+}
+
+GRID *GridCreate(int _width, int _height)
+{
+	GRID *_grid = (GRID*)malloc(sizeof(GRID));
+	if (_grid == NULL)
+		return NULL;
+	_grid->width = MAKEODD(max(_width, 7));
+	_grid->height = MAKEODD(max(_height, 7));
+	_grid->size = _grid->width * _grid->height;
+	_grid->bonus = 0;
+
+	// one allocation for every layer, the widest ones first to keep them aligned
+	size_t _size = (size_t)_grid->size;
+	_grid->planeWords = (_grid->width + PLANE_BITS - 1) / PLANE_BITS;
+	size_t _planeSize = (size_t)_grid->planeWords * (size_t)_grid->height;
+	_grid->memory = malloc(_planeSize * PLANE_COUNT * sizeof(unsigned long long) + _size * GRID_CELL_BYTES);
+	if (_grid->memory == NULL)
+	{
+		free(_grid);
+		return NULL;
+	}
+	_grid->planes = (unsigned long long*)_grid->memory;
+	_grid->dists = (int*)(_grid->planes + _planeSize * PLANE_COUNT);
+	_grid->stamps = (unsigned short*)(_grid->dists + _size);
+	_grid->types = (unsigned char*)(_grid->stamps + _size);
+	_grid->masks = _grid->types + _size;
+	_grid->depths = (signed char*)(_grid->masks + _size);
+
+	GridOffsets(_grid);
+
+	// set cell default values
+	memset(_grid->dists, 0, _size * sizeof(int));
+	memset(_grid->stamps, 0, _size * sizeof(unsigned short));
+	memset(_grid->types, CT_UNVISITED, _size);
+	memset(_grid->masks, 0, _size);
+	memset(_grid->depths, 0, _size);
+	_grid->stamp = 0;
+	_grid->viewer = 0;
+	_grid->viewerDepth = 0;
+	_grid->floodQueue = NULL;
+
+	return _grid;
+}
+
+GRID *GridCreateOver(int _width, int _height, int *_dists, unsigned char *_types, unsigned char *_masks)
+{
+	if ((_width < 7) || (_height < 7) || (_width % 2 == 0) || (_height % 2 == 0))
+		return NULL;
+	GRID *_grid = (GRID*)malloc(sizeof(GRID));
+	if (_grid == NULL)
+		return NULL;
+	_grid->width = _width;
+	_grid->height = _height;
+	_grid->size = _width * _height;
+	_grid->bonus = 0;
+
+	// only the visibility layers belong to the grid
+	size_t _size = (size_t)_grid->size;
+	_grid->memory = calloc(_size, sizeof(unsigned short) + 1);
+	if (_grid->memory == NULL)
+	{
+		free(_grid);
+		return NULL;
+	}
+	_grid->stamps = (unsigned short*)_grid->memory;
+	_grid->depths = (signed char*)(_grid->stamps + _size);
+	_grid->dists = _dists;
+	_grid->types = _types;
+	_grid->masks = _masks;
+	_grid->planeWords = 0;
+	_grid->planes = NULL;
+	GridOffsets(_grid);
+
+	_grid->stamp = 0;
+	_grid->viewer = 0;
+	_grid->viewerDepth = 0;
+	_grid->floodQueue = NULL;
+
+	return _grid;
+}
+
+size_t GridBytes(int _width, int _height)
+{
+	size_t _columns = (size_t)MAKEODD(max(_width, 7));
+	size_t _rows = (size_t)MAKEODD(max(_height, 7));
+	size_t _planeSize = (_columns + PLANE_BITS - 1) / PLANE_BITS * _rows;
+	return sizeof(GRID) + _planeSize * PLANE_COUNT * sizeof(unsigned long long) + _columns * _rows * GRID_CELL_BYTES;
+}
+
+void GridRemove(GRID *_grid)
+{
+	free(_grid->floodQueue);
+	free(_grid->memory);
+	free(_grid);
+}
+
+void GridMasks(GRID *_grid)
+{
+	memset(_grid->masks, 0, (size_t)_grid->size);
+	for (int _y = 1; _y < _grid->height - 1; _y += 1)
+	{
+		for (int _x = 1; _x < _grid->width - 1; _x += 1)
+		{
+			int _cell = GETCELL(_grid, _x, _y);
+			if (_grid->types[_cell] <= CT_WALL)
+				continue;
+			unsigned char _mask = 0;
+			for (int _dir = 0; _dir < 8; _dir += 1)
+			{
+				if (_grid->types[_cell + _grid->cellOffsets8[_dir]] > CT_WALL)
+					_mask |= (unsigned char)(1 << _dir);
+			}
+			_grid->masks[_cell] = _mask;
+		}
+	}
+}
+
+int GridTypesValid(int _width, int _height, const unsigned char *_types)
+{
+	for (int _y = 0; _y < _height; _y += 1)
+	{
+		const unsigned char *_row = _types + _y * _width;
+		int _border = (_y == 0) || (_y == _height - 1);
+		for (int _x = 0; _x < _width; _x += 1)
+		{
+			if (_row[_x] > CT_OPEN)
+				return 0;
+			if ((_border || (_x == 0) || (_x == _width - 1)) && (_row[_x] != CT_WALL))
+				return 0;
+		}
+	}
+	return 1;
+}
+
+int GridNeighborCount(GRID *_grid, int _cell)
+{
+	unsigned int _mask = _grid->masks[_cell];
+	_mask = (_mask & 0x55) + ((_mask >> 1) & 0x55);
+	_mask = (_mask & 0x33) + ((_mask >> 2) & 0x33);
+	return (int)((_mask & 0x0F) + (_mask >> 4));
+}
+
+//--------------------------------------------------------------------------------------------
+// PLANES
+//--------------------------------------------------------------------------------------------
+
+// Bit planes hold a bit per cell, rows padded to whole words, so the neighborhood of 64
+// cells is computed with a few shifts and logic operations instead of 8 loads per cell.
+
+#define PLANE_ROW(grid, plane, y)  ((grid)->planes + ((size_t)(plane) * (grid)->height + (y)) * (grid)->planeWords)
+
+// sets the bits of the row cells with work values in _lo.._hi
+static void PlaneBuild(GRID *_grid, const int *_work, int _plane, int _y, int _lo, int _hi)
+{
+	const int *_row = _work + _y * _grid->width;
+	unsigned long long *_bits = PLANE_ROW(_grid, _plane, _y);
+	for (int _j = 0; _j < _grid->planeWords; _j += 1)
+	{
+		int _x0 = _j * PLANE_BITS;
+		int _count = min(_grid->width - _x0, PLANE_BITS);
+		unsigned long long _word = 0;
+		for (int _b = 0; _b < _count; _b += 1)
+			_word |= (unsigned long long)((_row[_x0 + _b] >= _lo) & (_row[_x0 + _b] <= _hi)) << _b;
+		_bits[_j] = _word;
+	}
+}
+
+// word _j of a plane row moved so each bit holds the cell _dx columns away
+static unsigned long long PlaneShift(const unsigned long long *_bits, int _j, int _words, int _dx)
+{
+	if (_dx > 0)
+		return (_bits[_j] >> 1) | ((_j + 1 < _words) ? _bits[_j + 1] << (PLANE_BITS - 1) : 0);
+	if (_dx < 0)
+		return (_bits[_j] << 1) | ((_j > 0) ? _bits[_j - 1] >> (PLANE_BITS - 1) : 0);
+	return _bits[_j];
+}
+
+// word _j of the plane neighbors in the offsets8 direction _dir of row _y
+static unsigned long long PlaneNeighbor(GRID *_grid, int _plane, int _y, int _j, int _dir)
+{
+	const unsigned long long *_bits = PLANE_ROW(_grid, _plane, _y + offsets8[_dir][1]);
+	return PlaneShift(_bits, _j, _grid->planeWords, offsets8[_dir][0]);
+}
+
+// bits of word _j that lie in the columns _x0.._xL - 1
+static unsigned long long PlaneSpan(int _j, int _x0, int _xL)
+{
+	int _lo = max(_x0 - _j * PLANE_BITS, 0);
+	int _hi = min(_xL - _j * PLANE_BITS, PLANE_BITS);
+	if (_lo >= _hi)
+		return 0;
+	unsigned long long _mask = (_hi == PLANE_BITS) ? ~0ULL : (1ULL << _hi) - 1;
+	return _mask & ~((1ULL << _lo) - 1);
+}
+
+static int PlaneFirstBit(unsigned long long _word)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	return __builtin_ctzll(_word);
+#elif defined(_MSC_VER) && defined(_WIN64)
+	unsigned long _index;
+	_BitScanForward64(&_index, _word);
+	return (int)_index;
+#else
+	int _bit = 0;
+	for (; !(_word & 1); _word >>= 1)
+		_bit += 1;
+	return _bit;
+#endif
+}
+
+// 8x8 bit matrix transpose, bit 8 * r + c swaps with bit 8 * c + r
+static unsigned long long PlaneTranspose8(unsigned long long _x)
+{
+	unsigned long long _t;
+	_t = (_x ^ (_x >> 7)) & 0x00AA00AA00AA00AAULL;
+	_x = _x ^ _t ^ (_t << 7);
+	_t = (_x ^ (_x >> 14)) & 0x0000CCCC0000CCCCULL;
+	_x = _x ^ _t ^ (_t << 14);
+	_t = (_x ^ (_x >> 28)) & 0x00000000F0F0F0F0ULL;
+	_x = _x ^ _t ^ (_t << 28);
+	return _x;
+}
+
+//--------------------------------------------------------------------------------------------
+// CARVE
+//--------------------------------------------------------------------------------------------
+
+// When the carve reaches an end it goes on from the first odd unvisited cell, in row
+// order, next to a finished cell (above CT_OPEN). Those cells are kept as bits of plane 0,
+// set when a neighbor is finished and only checked when a new path is looked for, so
+// stale bits are dropped then and the whole carve stays linear. _frontier is the first
+// plane word that may hold bits.
+
+static void GridMazeFrontierAdd(GRID *_grid, int *_frontier, int _cell)
+{
+	if (_grid->dists[_cell] <= CT_OPEN)
+		return;
+	int _x = CELLX(_grid, _cell);
+	int _y = CELLY(_grid, _cell);
+	for (int _dir = 0; _dir < 4; _dir += 1)
+	{
+		int _nextX = _x + offsets4[_dir][0] * 2;
+		int _nextY = _y + offsets4[_dir][1] * 2;
+		if ((_nextX < 0) || (_nextX >= _grid->width) || (_nextY < 0) || (_nextY >= _grid->height))
+			continue;
+		int _word = _nextY * _grid->planeWords + _nextX / PLANE_BITS;
+		_grid->planes[_word] |= 1ULL << (_nextX % PLANE_BITS);
+		*_frontier = min(*_frontier, _word);
+	}
+}
+
+// first cell of the frontier and the direction of its finished neighbor, -1 when there is none
+static int GridMazeFrontierFirst(GRID *_grid, int *_frontier, int *_dir)
+{
+	int *_work = _grid->dists;
+	int _words = _grid->planeWords * _grid->height;
+	for (; *_frontier < _words; *_frontier += 1)
+	{
+		unsigned long long *_bits = _grid->planes + *_frontier;
+		while (*_bits != 0)
+		{
+			int _bit = PlaneFirstBit(*_bits);
+			int _x = (*_frontier % _grid->planeWords) * PLANE_BITS + _bit;
+			int _y = *_frontier / _grid->planeWords;
+			int _cellT = GETCELL(_grid, _x, _y);
+			if ((_x % 2 == 1) && (_y % 2 == 1) && (_work[_cellT] == CT_UNVISITED))
+			{
+				// check visited neighbors
+				for (int _dir2 = 0; _dir2 < 4; _dir2 += 1)
+				{
+					int _nextX = _x + offsets4[_dir2][0] * 2;
+					int _nextY = _y + offsets4[_dir2][1] * 2;
+					if (_nextX < 0) continue;
+					if (_nextX >= _grid->width) continue;
+					if (_nextY < 0) continue;
+					if (_nextY >= _grid->height) continue;
+					if (_work[GETCELL(_grid, _nextX, _nextY)] > CT_OPEN)
+					{
+						*_dir = _dir2;
+						return _cellT;
+					}
+				}
+			}
+			*_bits &= *_bits - 1; // stale, a finished neighbor sets it again
+		}
+	}
+	return -1;
+}
+
+// GridMaze works over the dists layer with the original single value encoding:
+// tile types below CT_OPEN and CT_OPEN plus the carve distance for corridors.
+// The layer is split into types and distances once the maze is done.
+
+static void GridMazeRoom(GENERATOR *_gen, GRID *_grid, int *_frontier, int _cell, int _cellsToEnd, int _count)
+{
+	int *_work = _grid->dists;
+
+	if (_work[_cell] == CT_END) // avoid ending cells
+		return;
+	if (_work[_cell] == CT_END_TEMP)
+		return;
+
+	// look for unvisited neighbors
+	for (
+		struct { int attempt; int dir; int turn; } _s = { 
+			0, 
+			GeneratorRandom(_gen, 0, 3), // random direction and turn
+			1 + GeneratorRandom(_gen, 0, 1) * 2 
+		};
+		_s.attempt < 4;
+		_s.attempt += 1, _s.dir = (_s.dir + _s.turn) % 4
+	) {
+		// check the other three corners of the room
+		int _cellN1 = _cell + _grid->cellOffsets4[_s.dir] * 2;
+		if (_cellN1 < 0) 
+			continue;
+		if (_cellN1 >= _grid->size)
+			continue;
+		if (_work[_cellN1] > CT_UNVISITED) 
+			continue;
+
+		int _dir2 = (_s.dir + _s.turn) % 4;
+		int _cellN2 = _cell + _grid->cellOffsets4[_dir2] * 2;
+		if (_cellN2 < 0)
+			continue;
+		if (_cellN2 >= _grid->size)
+			continue;
+		if (_work[_cellN2] > CT_UNVISITED)
+			continue;
+
+		int _cellN3 = _cell + (_grid->cellOffsets4[_s.dir] + _grid->cellOffsets4[_dir2]) * 2;
+		if (_cellN3 < 0)
+			continue;
+		if (_cellN3 >= _grid->size)
+			continue;
+		if (_work[_cellN3] > CT_UNVISITED)
+			continue;
+
+		// set the nine cells as walkable
+		int _posX = CELLX(_grid, _cell);
+		int _posY = CELLY(_grid, _cell);
+		for (
+			struct { int y; int yL; int stepY; int xL; int stepX; } _sT =
+			{
+				_posY,
+				_posY + (offsets4[_s.dir][1] + offsets4[_dir2][1]) * 3,
+				SIGN(CELLY(_grid, _cellN3) - _posY),
+				_posX + (offsets4[_s.dir][0] + offsets4[_dir2][0]) * 3,
+				SIGN(CELLX(_grid, _cellN3) - _posX)
+			};
+			_sT.y != _sT.yL; 
+			_sT.y += _sT.stepY
+		) {
+			for (int _x = _posX; _x != _sT.xL; _x += _sT.stepX)
+			{
+				int _cellT = GETCELL(_grid, _x, _sT.y);
+				if (_work[_cellT] > CT_START)
+					continue;
+
+				_work[_cellT] = _cellsToEnd;
+				GridMazeFrontierAdd(_grid, _frontier, _cellT);
+			}
+		}
+		if (0 < _count) // last room?
+		{
+			_cellsToEnd += 4;
+			int _room = GeneratorRandom(_gen, 0, 2);
+			switch (_room) {
+			case 0: GridMazeRoom(_gen, _grid, _frontier, _cellN1, _cellsToEnd, _count - 1); break;
+			case 1: GridMazeRoom(_gen, _grid, _frontier, _cellN2, _cellsToEnd, _count - 1); break;
+			case 2: GridMazeRoom(_gen, _grid, _frontier, _cellN3, _cellsToEnd, _count - 1); break;
+			}
+		}
+		break;
+	}
+}
+
+//--------------------------------------------------------------------------------------------
+// PIPELINE
+//--------------------------------------------------------------------------------------------
+
+// The post-processing of GridMaze runs as a pipeline of row stages over tiles of rows, so
+// large grids go through the cache once instead of once per pass. Each stage runs
+// MAZE_STAGE_LAG rows behind the previous one, enough for the neighborhoods they read and
+// write, and visits its rows in the same order a whole grid pass would, so the output does
+// not depend on the tile size. The random draws of the stages are hashes of the cell, not
+// draws of the generator, for the same reason.
+
+typedef struct
+{
+	GRID *grid;
+	int *work;
+	unsigned int noise; // seed of the per cell random draws
+	int cellStart;
+} MAZEPIPE;
+
+// random value of a cell in _min.._max, _salt tells apart the draws of the same cell
+static int MazeNoise(MAZEPIPE *_pipe, int _cell, int _salt, int _min, int _max)
+{
+	unsigned int _x = _pipe->noise + ((unsigned int)_cell * 8u + (unsigned int)_salt) * 0x9E3779B9u;
+	_x ^= _x >> 16;
+	_x *= 0x7FEB352Du;
+	_x ^= _x >> 15;
+	_x *= 0x846CA68Bu;
+	_x ^= _x >> 16;
+	return _min + (int)(_x % (unsigned int)(_max - _min + 1));
+}
+
+// Connect depth near
+static void MazeStageNear(MAZEPIPE *_pipe, int _y)
+{
+	GRID *_grid = _pipe->grid;
+	int *_work = _pipe->work;
+	if ((_y < 3) || (_y >= _grid->height - 3) || (_y % 2 == 0))
+		return;
+	for (int _x = 3; _x < _grid->width - 3; _x += 2)
+	{
+		int _cell = GETCELL(_grid, _x, _y);
+		if (_work[_cell] < CT_OPEN) // avoid special cells
+			continue;
+		for (int _dir = 0; _dir < 4; _dir += 1)
+		{
+			int _cellN = _cell + _grid->cellOffsets4[_dir] * 2;
+			if (_work[_cellN] < CT_OPEN)
+				continue;
+			if (MazeNoise(_pipe, _cell, _dir, 1, 100) <= MAZE_NEAR_PERCENT)
+				continue;
+			if (abs(_work[_cellN] - _work[_cell]) < 3)
+				_work[_cell + _grid->cellOffsets4[_dir]] = (_work[_cell] + _work[_cellN] / 2);
+		}
+	}
+}
+
+// walkable and wall planes for the isolated walls
+static void MazeStagePlanes(MAZEPIPE *_pipe, int _y)
+{
+	PlaneBuild(_pipe->grid, _pipe->work, 0, _y, CT_START, INT_MAX);
+	PlaneBuild(_pipe->grid, _pipe->work, 1, _y, CT_WALL, CT_WALL);
+}
+
+// Remove isolated wall cells
+// a wall ends surrounded only when its forward neighbors, right and the row below, are
+// walkable already, the backward ones may be walls removed earlier in this same stage
+static void MazeStageWalls(MAZEPIPE *_pipe, int _y)
+{
+	GRID *_grid = _pipe->grid;
+	int *_work = _pipe->work;
+	if ((_y < 2) || (_y >= _grid->height - 2))
+		return;
+	for (int _j = 0; _j < _grid->planeWords; _j += 1)
+	{
+		unsigned long long _bits = PLANE_ROW(_grid, 1, _y)[_j] & PlaneSpan(_j, 2, _grid->width - 2);
+		_bits &= PlaneNeighbor(_grid, 0, _y, _j, 0) & PlaneNeighbor(_grid, 0, _y, _j, 5);
+		_bits &= PlaneNeighbor(_grid, 0, _y, _j, 6) & PlaneNeighbor(_grid, 0, _y, _j, 7);
+		for (; _bits != 0; _bits &= _bits - 1)
+		{
+			int _bit = PlaneFirstBit(_bits);
+			int _cell = GETCELL(_grid, _j * PLANE_BITS + _bit, _y);
+			int _cellsToEnd = 0;
+			int _dir = 0;
+			for (; _dir < 8; _dir += 1)
+			{
+				int _typeN = _work[_cell + _grid->cellOffsets8[_dir]];
+				if (_typeN < CT_START)
+					break;
+				if ((_typeN >= CT_START) && (_typeN <= CT_END)) // start and end are navigable cells that has no depth value as ID
+					if (_cellsToEnd < CT_OPEN)
+						_cellsToEnd = CT_OPEN;
+					else
+						_cellsToEnd += _cellsToEnd / (_dir + 1); // add the average of already found neighbors
+				else
+					_cellsToEnd += _typeN;
+			}
+			if (_dir == 8) // if it is surrounded
+			{
+				_work[_cell] = _cellsToEnd / 8; // set the depth average of all its neighborhood
+				PLANE_ROW(_grid, 0, _y)[_j] |= 1ULL << _bit;
+			}
+		}
+	}
+}
+
+static void MazeStageStart(MAZEPIPE *_pipe, int _y)
+{
+	if (CELLY(_pipe->grid, _pipe->cellStart) == _y)
+		_pipe->work[_pipe->cellStart] = CT_START;
+}
+
+// count neighbors and identify room centers
+// the eight neighbor planes of a word are transposed 8 cells at a time into their masks
+static void MazeStageNeighbors(MAZEPIPE *_pipe, int _y)
+{
+	GRID *_grid = _pipe->grid;
+	int *_work = _pipe->work;
+	unsigned long long *_rooms = PLANE_ROW(_grid, 2, _y);
+	unsigned long long *_open = PLANE_ROW(_grid, 1, _y);
+	if ((_y < 1) || (_y >= _grid->height - 1))
+	{
+		memset(_rooms, 0, (size_t)_grid->planeWords * sizeof(unsigned long long));
+		return;
+	}
+	PlaneBuild(_grid, _work, 1, _y, CT_OPEN, INT_MAX);
+	for (int _j = 0; _j < _grid->planeWords; _j += 1) {
+		unsigned long long _bits = PLANE_ROW(_grid, 0, _y)[_j] & PlaneSpan(_j, 1, _grid->width - 1);
+		_rooms[_j] = 0;
+		if (_bits == 0)
+			continue;
+		unsigned long long _neighbors[8];
+		unsigned long long _room = _bits;
+		for (int _dir = 0; _dir < 8; _dir += 1) {
+			_neighbors[_dir] = PlaneNeighbor(_grid, 0, _y, _j, _dir) & _bits;
+			_room &= _neighbors[_dir];
+		}
+		for (int _x = 0; (_x < PLANE_BITS) && (_bits >> _x != 0); _x += 8) {
+			unsigned long long _bytes = 0;
+			for (int _dir = 0; _dir < 8; _dir += 1)
+				_bytes |= ((_neighbors[_dir] >> _x) & 0xFF) << (_dir * 8);
+			_bytes = PlaneTranspose8(_bytes);
+			int _cell = GETCELL(_grid, _j * PLANE_BITS + _x, _y);
+			for (int _b = 0; _b < 8; _b += 1, _bytes >>= 8)
+				if (_bytes & 0xFF)
+					_grid->masks[_cell + _b] = (unsigned char)_bytes;
+		}
+		_rooms[_j] = _room;
+		_open[_j] &= ~_room;
+		for (; _room != 0; _room &= _room - 1)
+			_work[GETCELL(_grid, _j * PLANE_BITS + PlaneFirstBit(_room), _y)] = CT_ROOM_CENTER;
+	}
+}
+
+// identify room borders
+static void MazeStageBorders(MAZEPIPE *_pipe, int _y)
+{
+	GRID *_grid = _pipe->grid;
+	if ((_y < 1) || (_y >= _grid->height - 1))
+		return;
+	for (int _j = 0; _j < _grid->planeWords; _j += 1) {
+		unsigned long long _bits = PLANE_ROW(_grid, 1, _y)[_j] & PlaneSpan(_j, 1, _grid->width - 1);
+		if (_bits == 0)
+			continue;
+		unsigned long long _rooms = 0;
+		for (int _dir = 0; _dir < 8; _dir += 1)
+			_rooms |= PlaneNeighbor(_grid, 2, _y, _j, _dir);
+		for (_bits &= _rooms; _bits != 0; _bits &= _bits - 1)
+			_pipe->work[GETCELL(_grid, _j * PLANE_BITS + PlaneFirstBit(_bits), _y)] = CT_ROOM_BORDER;
+	}
+}
+
+// doors around rooms
+static void MazeStageDoors(MAZEPIPE *_pipe, int _y)
+{
+	GRID *_grid = _pipe->grid;
+	int *_work = _pipe->work;
+	if ((_y < 1) || (_y >= _grid->height - 1))
+		return;
+	for (int _x = 1; _x < _grid->width - 1; _x += 1) {
+		int _cell = GETCELL(_grid, _x, _y);
+		if (_work[_cell] < CT_OPEN) // avoid any special cell
+			continue;
+		for (int _dir = 0; _dir < 4; _dir += 1) {
+			if (_work[_cell + _grid->cellOffsets4[_dir]] != CT_ROOM_BORDER)
+				continue;
+			_work[_cell] = CT_DOOR;
+			break;
+		}
+	}
+}
+
+// doors on corridor crosses
+static void MazeStageCrossDoors(MAZEPIPE *_pipe, int _y)
+{
+	GRID *_grid = _pipe->grid;
+	int *_work = _pipe->work;
+	if ((_y < 1) || (_y >= _grid->height - 1))
+		return;
+	for (int _x = 1; _x < _grid->width - 1; _x += 1) {
+		int _cell = GETCELL(_grid, _x, _y);
+		if (_work[_cell] < CT_OPEN) // avoid any special cell
+			continue;
+		int _count = 0;
+		int _cellCheapest = _cell;
+		int _dir = 0;
+		for (; _dir < 4; _dir += 1) {
+			int _cellN = _cell + _grid->cellOffsets4[_dir];
+			if (_work[_cellN] < CT_OPEN)
+				continue;
+			_count += 1;
+			if (_work[_cellN] >= _work[_cellCheapest])
+				continue;
+			_cellCheapest = _cellN;
+		}
+		if (_cell != _cellCheapest)
+			if (_count > 2)
+				_work[_cellCheapest] = CT_DOOR;
+	}
+}
+
+// corridor treasures
+static void MazeStageCorridorBonus(MAZEPIPE *_pipe, int _y)
+{
+	GRID *_grid = _pipe->grid;
+	int *_work = _pipe->work;
+	if ((_y >= _grid->height - 1) || (_y % 2 == 0))
+		return;
+	for (int _x = 1; _x < _grid->width - 1; _x += 2) {
+		int _cell = GETCELL(_grid, _x, _y);
+		if (_work[_cell] < CT_OPEN) // avoid special cells
+			continue;
+		if (GridNeighborCount(_grid, _cell) != 1)
+			continue;
+		if (MazeNoise(_pipe, _cell, 4, 0, 100) > MAZE_DEAD_BONUS_PERCENT)
+			continue;
+		_work[_cell] = CT_BONUS;
+		_grid->bonus += 1;
+	}
+}
+
+// room treasures
+static void MazeStageRoomBonus(MAZEPIPE *_pipe, int _y)
+{
+	GRID *_grid = _pipe->grid;
+	int *_work = _pipe->work;
+	if ((_y < 1) || (_y >= _grid->height - 1))
+		return;
+	for (int _x = 1; _x < _grid->width - 1; _x += 1) {
+		int _cell = GETCELL(_grid, _x, _y);
+		if (_work[_cell] < CT_ROOM_CENTER) // avoid special cells
+			continue;
+		if (_work[_cell] > CT_ROOM_BORDER) // avoid corridor cells
+			continue;
+		if (MazeNoise(_pipe, _cell, 5, 0, 100) > MAZE_ROOM_BONUS_PERCENT)
+			continue;
+		_work[_cell] = CT_BONUS;
+		_grid->bonus += 1;
+	}
+}
+
+// split the work layer into tile types and carve distances
+static void MazeStageSplit(MAZEPIPE *_pipe, int _y)
+{
+	GRID *_grid = _pipe->grid;
+	int *_row = _pipe->work + _y * _grid->width;
+	unsigned char *_types = _grid->types + _y * _grid->width;
+	for (int _x = 0; _x < _grid->width; _x += 1)
+	{
+		int _value = _row[_x];
+		if (_value < CT_OPEN)
+		{
+			_types[_x] = (unsigned char)_value;
+			_row[_x] = 0;
+		}
+		else
+		{
+			_types[_x] = CT_OPEN;
+			_row[_x] = _value - CT_OPEN;
+		}
+	}
+}
+
+typedef struct
+{
+	void (*func)(MAZEPIPE *_pipe, int _y);
+	int pass; // MAZE_PASS_* the stage time is accounted to
+} MAZESTAGE;
+
+static const MAZESTAGE mazeStages[] =
+{
+	{ MazeStageNear,          MAZE_PASS_CONNECT_NEAR },
+	{ MazeStagePlanes,        MAZE_PASS_ISOLATED_WALLS },
+	{ MazeStageWalls,         MAZE_PASS_ISOLATED_WALLS },
+	{ MazeStageStart,         MAZE_PASS_START },
+	{ MazeStageNeighbors,     MAZE_PASS_NEIGHBORS },
+	{ MazeStageBorders,       MAZE_PASS_ROOM_BORDERS },
+	{ MazeStageDoors,         MAZE_PASS_ROOM_DOORS },
+	{ MazeStageCrossDoors,    MAZE_PASS_CROSS_DOORS },
+	{ MazeStageCorridorBonus, MAZE_PASS_CORRIDOR_BONUS },
+	{ MazeStageRoomBonus,     MAZE_PASS_ROOM_BONUS },
+	{ MazeStageSplit,         MAZE_PASS_SPLIT }
+};
+
+#define MAZE_STAGE_COUNT  ((int)(sizeof(mazeStages) / sizeof(mazeStages[0])))
+
+//--------------------------------------------------------------------------------------------
+// BONUS REPAIR
+//--------------------------------------------------------------------------------------------
+
+// bonus candidates by preference: dead ends, room tiles and any other corridor cell
+static int GridMazeBonusCandidate(GRID *_grid, int _cell, int _tier)
+{
+	switch (_tier)
+	{
+	case 0: return (_grid->types[_cell] == CT_OPEN) && (GridNeighborCount(_grid, _cell) == 1);
+	case 1: return (_grid->types[_cell] == CT_ROOM_CENTER) || (_grid->types[_cell] == CT_ROOM_BORDER);
+	default: return (_grid->types[_cell] == CT_OPEN) && (GridNeighborCount(_grid, _cell) != 1);
+	}
+}
+
+// Turns candidates of a tier into bonuses until the grid holds bonusMin of them. Every
+// candidate has the same chance to be picked, through selection sampling: two sweeps and
+// no memory, so the time is bound by the grid size instead of by luck.
+static void GridMazeBonusRepair(GENERATOR *_gen, GRID *_grid, int _tier)
+{
+	int _count = 0;
+	for (int _cell = 0; _cell < _grid->size; _cell += 1)
+		_count += GridMazeBonusCandidate(_grid, _cell, _tier);
+
+	int _needed = min(_gen->bonusMin - _grid->bonus, _count);
+	for (int _cell = 0; (_cell < _grid->size) && (_needed > 0); _cell += 1)
+	{
+		if (!GridMazeBonusCandidate(_grid, _cell, _tier))
+			continue;
+		if (GeneratorRandom(_gen, 1, _count) <= _needed)
+		{
+			_grid->types[_cell] = CT_BONUS;
+			_grid->dists[_cell] = 0;
+			_grid->bonus += 1;
+			_needed -= 1;
+			if (_gen->stats != NULL)
+				_gen->stats->repairs += 1;
+		}
+		_count -= 1;
+	}
+}
+
+int GridMaze(GENERATOR *_gen, GRID *_grid) {
+	double _time = GeneratorPass(_gen, -1, 0);
+	int *_work = _grid->dists;
+
+	// prepare the grid for maze
+	// it states walkable cells as CT_UNVISITED (0)
+	// walls pattern
+	// X X X X X X X 
+	// X 0 X 0 X 0 X
+	// X X X X X X X
+	// X 0 X 0 X 0 X
+	// X X X X X X X
+	for (int _y = 0; _y < _grid->height; _y += 1)
+	{
+		int *_row = _work + _y * _grid->width;
+		if (_y % 2 == 0) // pair rows
+		{
+			for (int _x = 0; _x < _grid->width; _x += 1)
+				_row[_x] = CT_WALL;
+		}
+		else // odd rows
+		{
+			for (int _x = 0; _x < _grid->width; _x += 1)
+				_row[_x] = (_x % 2 == 0) ? CT_WALL : CT_UNVISITED;
+		}
+	}
+	memset(_grid->masks, 0, (size_t)_grid->size);
+	memset(_grid->depths, 0, (size_t)_grid->size);
+	memset(_grid->stamps, 0, (size_t)_grid->size * sizeof(unsigned short));
+	_grid->stamp = 0;
+
+	_grid->bonus = 0;
+
+	// break the outter square shape of the grid by disabling some cells beside the border
+	for (int _x = 1; _x < _grid->width; _x += _grid->width - 3) { // two loops, left and right columns
+		for (int _y = 1; _y < _grid->height; _y += 2) { // odd indexed cells
+			if (GeneratorRandom(_gen, 0, 1) > 0)
+				continue;
+			_work[_x + _y * _grid->width] = CT_WALL;
+		}
+	}
+	for (int _y = 1; _y < _grid->height; _y += _grid->height - 3) { // two loops, up and down rows
+		for (int _x = 1; _x < _grid->width; _x += 2) { // odd indexed cells
+			if (GeneratorRandom(_gen, 0, 1) > 0)
+				continue;
+			_work[_x + _y * _grid->width] = CT_WALL;
+		}
+	}
+
+	// random ending cell
+	// odd coordinates
+	int _frontier = 0;
+	memset(_grid->planes, 0, (size_t)_grid->planeWords * _grid->height * sizeof(unsigned long long));
+
+	int _cellEnd = GETCELL(_grid, MAKEODD(GeneratorRandom(_gen, 3, _grid->width - 4)), MAKEODD(GeneratorRandom(_gen, 3, _grid->height - 4)));
+	_work[_cellEnd] = CT_END;
+
+	// the carve starts from the ending cell, so it needs a cell beside it the border cut left
+	int _dirEnd = 0;
+	while ((_dirEnd < 4) && (_work[_cellEnd + _grid->cellOffsets4[_dirEnd] * 2] != CT_UNVISITED))
+		_dirEnd += 1;
+	if (_dirEnd == 4)
+		_work[_cellEnd + _grid->cellOffsets4[GeneratorRandom(_gen, 0, 3)] * 2] = CT_UNVISITED;
+
+	int _cellsToEnd = CT_OPEN;
+	int _cell = _cellEnd;
+	int _carved = 0;
+
+	while (1)
+	{
+		// get random direction and turn direction
+		int _dir = GeneratorRandom(_gen, 0, 3);
+		int _turnSide = 1 + GeneratorRandom(_gen, 0, 1) * 2;
+
+		// look for unvisited neighbor cell
+		int _attempts = 0;
+		for (; _attempts < 4; _attempts += 1, _dir = (_dir + _turnSide) % 4)
+		{
+			// random sudden cuts results in more dead ends
+			if (GeneratorRandom(_gen, 1, 100) <= MAZE_CUT_PERCENT) {
+				_attempts = 4;
+				break;
+			}
+
+			// check grid bounds
+			int _nextX = CELLX(_grid, _cell) + offsets4[_dir][0] * 2;
+			if (_nextX < 0) continue;
+			if (_nextX >= _grid->width) continue;
+
+			int _nextY = CELLY(_grid, _cell) + offsets4[_dir][1] * 2;
+			if (_nextY < 0) continue;
+			if (_nextY >= _grid->height) continue;
+
+			// get nextcell
+			int _cellN = _cell + _grid->cellOffsets4[_dir] * 2;
+
+			// skip already visited cells
+			if (_work[_cellN] > CT_UNVISITED) continue;
+
+			// set next cell as walkable
+			_work[_cellN] = CT_OPEN;
+
+			// set also the cell in the middle
+			_work[_cell + _grid->cellOffsets4[_dir]] = CT_OPEN;
+
+			// save the stepped position
+			_cell = _cellN;
+
+			// increase the depth
+			_cellsToEnd += 2;
+			_carved = 1;
+
+			// random rooms
+			if (GeneratorRandom(_gen, 1, 100) <= MAZE_ROOM_PERCENT)
+				GridMazeRoom(_gen, _grid, &_frontier, _cell, _cellsToEnd, 1);
+			
+			break;
+		}
+
+		if (_attempts == 4) // if it could not find a walkable neighbor
+		{
+			if ((_work[_cell] != CT_END) && (_work[_cell] != CT_END_TEMP))  // not an end yet
+			{
+				// go back to an open cell
+				_work[_cell] = _cellsToEnd;
+				GridMazeFrontierAdd(_grid, &_frontier, _cell);
+				_cellsToEnd -= 1;
+				int _dir2 = 0;
+				for (; _dir2 < 4; _dir2 += 1)
+				{
+					int _cellN = _cell + _grid->cellOffsets4[_dir2];
+					if (_work[_cellN] != CT_OPEN)
+						continue;
+					_work[_cellN] = _cellsToEnd;
+					_cellsToEnd -= 1;
+					_cell = _cellN + _grid->cellOffsets4[_dir2];
+					break;
+				}
+#ifdef _DEBUG
+				if (_dir2 == 4)
+					fprintf(stderr, "UNKNOWN ERROR: Open cell not found\n       Current depth:%i\n       Cell type: %i\n", _cellsToEnd, _work[_cell]);
+#endif
+			}
+			else // end reached
+			{
+				// set temporary ending cells as a common walkable cell
+				if (_work[_cell] == CT_END_TEMP)
+				{
+					_work[_cell] = _cellsToEnd;
+					GridMazeFrontierAdd(_grid, &_frontier, _cell);
+				}
+
+				// Look for unvisited cells
+				int _dir2 = 0;
+				int _cellT = GridMazeFrontierFirst(_grid, &_frontier, &_dir2);
+				if (_cellT < 0)
+				{
+					if (!_carved) // a cut on the very first step, the ending cell has room to start over
+						continue;
+					break;
+				}
+				int _cellN = _cellT + _grid->cellOffsets4[_dir2] * 2;
+
+				// set the cell in the middle as walkable
+				int _cellN2 = _cellT + _grid->cellOffsets4[_dir2];
+				_work[_cellN2] = _work[_cellN] + 1; // one step further of found neighbor depth
+
+				// start a new path
+				_cell = _cellT;
+				_work[_cell] = CT_END_TEMP; // set as a temporary end cell
+				_cellsToEnd = _work[_cellN2] + 1; // one step further for next cells
+			}
+		}
+	}
+
+	_time = GeneratorPass(_gen, MAZE_PASS_CARVE, _time);
+
+	// Look for start point
+	// outer odd cells keep their carve values along the post-processing, so it is done first
+	int _cellStart = 0;
+	for (int _i = 1; _i < _grid->width / 2; _i += 2) // look on outter cells first, odd indexed cells 
+	{
+		for (int _x = _i; _x < _grid->width; _x += _grid->width - (_i + 2)) { // two loops, left and right columns
+			for (int _y = _i; _y < _grid->height; _y += 2) { // odd indexed cells
+				_cell = GETCELL(_grid, _x, _y);
+				if (_work[_cell] > _work[_cellStart])
+					_cellStart = _cell;
+			}
+		}
+		for (int _y = _i; _y < _grid->height; _y += _grid->height - (_i + 2)) { // two loops, up and down rows
+			for (int _x = _i; _x < _grid->width; _x += 2) { // odd indexed cells
+				_cell = GETCELL(_grid, _x, _y);
+				if (_work[_cell] > _work[_cellStart])
+					_cellStart = _cell;
+			}
+		}
+		break; // early break that ensures the starting cell is in the border of the maze
+	}
+	if (_cellStart == 0) // the border cut walled the carve in, its farthest odd cell instead
+	{
+		for (int _y = 1; _y < _grid->height; _y += 2) {
+			for (int _x = 1; _x < _grid->width; _x += 2) {
+				_cell = GETCELL(_grid, _x, _y);
+				if (_work[_cell] > _work[_cellStart])
+					_cellStart = _cell;
+			}
+		}
+	}
+
+	_time = GeneratorPass(_gen, MAZE_PASS_START, _time);
+
+	// post-processing stages streamed over row tiles
+	MAZEPIPE _pipe;
+	_pipe.grid = _grid;
+	_pipe.work = _work;
+	_pipe.noise = GeneratorNext(_gen);
+	_pipe.cellStart = _cellStart;
+
+	int _done[MAZE_STAGE_COUNT];
+	for (int _stage = 0; _stage < MAZE_STAGE_COUNT; _stage += 1)
+		_done[_stage] = 0;
+	int _tile = max(MAZE_TILE_BYTES / (_grid->width * (int)sizeof(int)), 1);
+	for (int _front = _tile; _done[MAZE_STAGE_COUNT - 1] < _grid->height; _front += _tile)
+	{
+		for (int _stage = 0; _stage < MAZE_STAGE_COUNT; _stage += 1)
+		{
+			int _end = min(_front - _stage * MAZE_STAGE_LAG, _grid->height);
+			if (_end <= _done[_stage])
+				continue;
+			for (int _y = _done[_stage]; _y < _end; _y += 1)
+				mazeStages[_stage].func(&_pipe, _y);
+			_done[_stage] = _end;
+			_time = GeneratorPass(_gen, mazeStages[_stage].pass, _time);
+		}
+	}
+
+	// bonus repair
+	for (int _tier = 0; (_tier < 3) && (_grid->bonus < _gen->bonusMin); _tier += 1)
+		GridMazeBonusRepair(_gen, _grid, _tier);
+
+	_time = GeneratorPass(_gen, MAZE_PASS_BONUS_REPAIR, _time);
+
+	return _cellStart;
+}
+
+GRID *GridFromId(const MAZEID *_id, int *_cellStart)
+{
+	GRID *_grid = GridCreate(_id->width, _id->height);
+	if (_grid == NULL)
+		return NULL;
+	GENERATOR _gen;
+	GeneratorInit(&_gen, _id->seed);
+	_gen.bonusMin = _id->bonusMin;
+	int _cell = GridMaze(&_gen, _grid);
+	if (_cellStart != NULL)
+		*_cellStart = _cell;
+	return _grid;
+}
+
+//--------------------------------------------------------------------------------------------
+// VISIBILITY
+//--------------------------------------------------------------------------------------------
+
+// Visibility spreads from the viewer losing 5 - neighbors / 2 depth units per step, so
+// open rooms are seen further than corridors. Cells are settled in decreasing depth order
+// through a bucket queue, so each one spreads at most once and with the best depth that
+// reaches it. Cells out of the flood keep the depth of the last flood that reached them.
+
+typedef struct
+{
+	FLOODITEM *items;
+	int count;
+	int buckets[FLOOD_BUCKETS];
+} FLOOD;
+
+static int FloodInit(GRID *_grid, FLOOD *_flood)
+{
+	if (_grid->floodQueue == NULL)
+	{
+		_grid->floodQueue = (FLOODITEM*)malloc(sizeof(FLOODITEM) * FLOOD_ITEMS);
+		if (_grid->floodQueue == NULL)
+			return 0;
+	}
+	_flood->items = _grid->floodQueue;
+	_flood->count = 0;
+	for (int _bucket = 0; _bucket < FLOOD_BUCKETS; _bucket += 1)
+		_flood->buckets[_bucket] = -1;
+	return 1;
+}
+
+static void FloodPush(FLOOD *_flood, int _cell, int _depth)
+{
+	if (_flood->count == FLOOD_ITEMS) // unreachable, see FLOOD_ITEMS
+		return;
+	int _bucket = _depth - MAZE_VISIBILITY_MIN;
+	_flood->items[_flood->count].cell = _cell;
+	_flood->items[_flood->count].next = _flood->buckets[_bucket];
+	_flood->buckets[_bucket] = _flood->count;
+	_flood->count += 1;
+}
+
+// pushes the neighbors of a settled cell
+static void FloodSpread(GRID *_grid, FLOOD *_flood, int _cell)
+{
+	int _depth = _grid->depths[_cell];
+
+	// end by depth
+	if (_depth < MAZE_VISIBILITY_END)
+		return;
+
+	// end by visibility blocking cells
+	if ((_grid->types[_cell] <= CT_WALL) || (_grid->types[_cell] == CT_DOOR))
+		return;
+
+	// flood neighborhood
+	_depth -= 5 - GridNeighborCount(_grid, _cell) / 2;
+	for (int _dir = 0; _dir < 8; _dir += 1)
+	{
+		int _cellT = _cell + _grid->cellOffsets8[_dir];
+		if ((_grid->stamps[_cellT] == _grid->stamp) && (_grid->depths[_cellT] >= _depth)) // avoid nearer already computed cells
+			continue;
+		FloodPush(_flood, _cellT, _depth);
+	}
+}
+
+// settles the queued cells from the _depth bucket down
+static void FloodRun(GRID *_grid, FLOOD *_flood, int _depth)
+{
+	for (int _bucket = _depth - MAZE_VISIBILITY_MIN; _bucket >= 0; _bucket -= 1)
+	{
+		_depth = _bucket + MAZE_VISIBILITY_MIN;
+		while (_flood->buckets[_bucket] >= 0)
+		{
+			FLOODITEM *_item = _flood->items + _flood->buckets[_bucket];
+			_flood->buckets[_bucket] = _item->next;
+			int _cell = _item->cell;
+
+			// avoid cells already settled by a nearer path
+			if ((_grid->stamps[_cell] == _grid->stamp) && (_grid->depths[_cell] >= _depth))
+				continue;
+			_grid->stamps[_cell] = _grid->stamp;
+			_grid->depths[_cell] = (signed char)_depth;
+
+			FloodSpread(_grid, _flood, _cell);
+		}
+	}
+}
+
+int GridVisibilityBegin(GRID *_grid, int _cell, int _depth)
+{
+	// new flood generation, restart the stamps when the counter wraps around
+	_grid->stamp += 1;
+	if (_grid->stamp == 0)
+	{
+		memset(_grid->stamps, 0, (size_t)_grid->size * sizeof(unsigned short));
+		_grid->stamp = 1;
+	}
+
+	_depth = max(min(_depth, MAZE_VISIBILITY_MAX), MAZE_VISIBILITY_MIN);
+	_grid->viewer = _cell;
+	_grid->viewerDepth = _depth;
+	return _depth;
+}
+
+void GridFloodVisibility(GRID *_grid, int _cell, int _depth)
+{
+	FLOOD _flood;
+	if (!FloodInit(_grid, &_flood))
+		return;
+
+	_depth = GridVisibilityBegin(_grid, _cell, _depth);
+	FloodPush(&_flood, _cell, _depth);
+	FloodRun(_grid, &_flood, _depth);
+}
+
+#ifdef MAZE_VISIBILITY_CHECK
+// compares the incremental visibility against a full flood from the viewer over a copy of
+// the layers taken before the update
+static void VisibilityCheck(GRID *_grid, signed char *_depthsBefore, unsigned short *_stampsBefore, const char *_update)
+{
+	signed char *_depths = _grid->depths;
+	unsigned short *_stamps = _grid->stamps;
+	unsigned short _stamp = _grid->stamp;
+
+	_grid->depths = _depthsBefore;
+	_grid->stamps = _stampsBefore;
+	GridFloodVisibility(_grid, _grid->viewer, _grid->viewerDepth);
+	unsigned short _stampFull = _grid->stamp;
+
+	int _errors = 0;
+	for (int _i = 0; _i < _grid->size; _i += 1)
+	{
+		int _reached = _stamps[_i] == _stamp;
+		int _reachedFull = _stampsBefore[_i] == _stampFull;
+		if ((_depths[_i] == _depthsBefore[_i]) && (_reached == _reachedFull))
+			continue;
+		if (_errors < 8)
+			fprintf(stderr, "VISIBILITY CHECK: %s, cell %i,%i depth %i, full flood %i\n", _update,
+				CELLX(_grid, _i), CELLY(_grid, _i), _depths[_i], _depthsBefore[_i]);
+		_errors += 1;
+	}
+	if (_errors > 0)
+		fprintf(stderr, "VISIBILITY CHECK: %s, %i cells differ\n", _update, _errors);
+
+	_grid->depths = _depths;
+	_grid->stamps = _stamps;
+	_grid->stamp = _stamp;
+}
+#endif
+
+// Blocking cells that turn walkable only raise depths: the flood restarts from them and
+// reaches just the cells they improve, instead of the whole radius around the viewer.
+void GridVisibilityOpenCells(GRID *_grid, const int *_cells, int _count)
+{
+	if (_grid->stamp == 0) // no flood yet
+		return;
+	if (_count > FLOOD_SEEDS) // the queue only has room for the spreads of FLOOD_SEEDS
+	{
+		GridFloodVisibility(_grid, _grid->viewer, _grid->viewerDepth);
+		return;
+	}
+
+	FLOOD _flood;
+	if (!FloodInit(_grid, &_flood))
+		return;
+
+#ifdef MAZE_VISIBILITY_CHECK
+	size_t _size = (size_t)_grid->size;
+	signed char *_depthsBefore = (signed char*)malloc(_size);
+	unsigned short *_stampsBefore = (unsigned short*)malloc(_size * sizeof(unsigned short));
+	if ((_depthsBefore != NULL) && (_stampsBefore != NULL))
+	{
+		memcpy(_depthsBefore, _grid->depths, _size);
+		memcpy(_stampsBefore, _grid->stamps, _size * sizeof(unsigned short));
+	}
+#endif
+
+	for (int _i = 0; _i < _count; _i += 1)
+	{
+		if (_grid->stamps[_cells[_i]] == _grid->stamp) // out of the current flood otherwise
+			FloodSpread(_grid, &_flood, _cells[_i]);
+	}
+	FloodRun(_grid, &_flood, MAZE_VISIBILITY_MAX);
+
+#ifdef MAZE_VISIBILITY_CHECK
+	if ((_depthsBefore != NULL) && (_stampsBefore != NULL))
+		VisibilityCheck(_grid, _depthsBefore, _stampsBefore, "open");
+	free(_depthsBefore);
+	free(_stampsBefore);
+#endif
+}
+
+void GridVisibilityOpen(GRID *_grid, int _cell)
+{
+	GridVisibilityOpenCells(_grid, &_cell, 1);
+}
@@ -0,0 +1,172 @@
+/**********************************************************************************************
+*
+*   maze - headless maze core
+*
+*   Grid storage, random depth first maze generation and visibility flood. It does not
+*   depend on raylib, so mazes can be generated and profiled without a window or an
+*   audio device, from batch jobs, benchmarks or worker threads.
+*
+*   All the randomness of the generation comes from a GENERATOR context owned by the
+*   caller, with no shared state, so mazes can be generated on many threads at once. Two
+*   generators initialized with the same seed build the same maze, in a single pass: mazes
+*   short of bonuses are repaired, never generated again.
+*
+*   LICENSE: zlib/libpng
+*
+*   Copyright (c) 2020 Jose Miguel Rodriguez Chavarri (https://github.com/txesmi/)
+*
+**********************************************************************************************/
+
+#ifndef MAZE_H
+#define MAZE_H
+
+#include <stddef.h>
+
+//--------------------------------------------------------------------------------------------
+// DEFINES
+//--------------------------------------------------------------------------------------------
+
+#define MAZE_VISIBILITY_MAX       30 // depth max into visibility flood
+#define MAZE_VISIBILITY_END       -4 // cells below this depth stop the flood
+#define MAZE_VISIBILITY_MIN       (MAZE_VISIBILITY_END - 5) // lowest depth a flood can reach
+#define MAZE_ROOM_PERCENT         80 // percent of room creation tries
+#define MAZE_NEAR_PERCENT         30 // percent of conections of near depth
+#define MAZE_CUT_PERCENT          10 // percent of forced dead ends
+#define MAZE_ROOM_BONUS_PERCENT   15 // percent of room tiles filled with bonuses
+#define MAZE_DEAD_BONUS_PERCENT   60 // percent of dead end tiles filled with bonuses
+
+//--------------------------------------------------------------------------------------------
+// MACROS
+//--------------------------------------------------------------------------------------------
+
+// cells are indexes into the grid layers
+#define GETCELL(grid, x, y)  ((x) + (y) * (grid)->width)
+#define CELLX(grid, cell)    ((cell) % (grid)->width)
+#define CELLY(grid, cell)    ((cell) / (grid)->width)
+
+#define GRID_CELL_BYTES      (sizeof(int) + sizeof(unsigned short) + 3) // memory of a cell over all the byte layers, bit planes aside
+
+//--------------------------------------------------------------------------------------------
+// GENERATOR
+//--------------------------------------------------------------------------------------------
+
+enum MazePasses
+{
+	MAZE_PASS_CARVE,
+	MAZE_PASS_CONNECT_NEAR,
+	MAZE_PASS_ISOLATED_WALLS,
+	MAZE_PASS_START,
+	MAZE_PASS_NEIGHBORS,
+	MAZE_PASS_ROOM_BORDERS,
+	MAZE_PASS_ROOM_DOORS,
+	MAZE_PASS_CROSS_DOORS,
+	MAZE_PASS_CORRIDOR_BONUS,
+	MAZE_PASS_ROOM_BONUS,
+	MAZE_PASS_SPLIT,
+	MAZE_PASS_BONUS_REPAIR,
+	MAZE_PASS_COUNT
+};
+
+typedef struct
+{
+	int repairs; // bonuses placed after the post-processing to reach bonusMin
+	double passTime[MAZE_PASS_COUNT]; // accumulated seconds spent on each pass
+} MAZE_STATS;
+
+typedef struct
+{
+	unsigned int state[4]; // xoshiro128** state, never all zero
+	int bonusMin; // bonuses GridMaze guarantees as long as the maze has room for them, 1 by default
+	MAZE_STATS *stats; // optional, filled by GridMaze when not NULL
+} GENERATOR;
+
+// Everything a maze depends on. The same ID builds the same maze with the same build of
+// the core, so mazes can be regenerated from their ID instead of stored.
+typedef struct
+{
+	unsigned long long seed;
+	int width;
+	int height;
+	int bonusMin;
+} MAZEID;
+
+void GeneratorInit(GENERATOR *_gen, unsigned long long _seed);
+void GeneratorStream(GENERATOR *_gen, unsigned long long _seed, int _stream); // _stream jumps after the init
+void GeneratorJump(GENERATOR *_gen); // skips 2^64 draws, streams jumped apart never overlap
+unsigned int GeneratorNext(GENERATOR *_gen); // 32 random bits
+int GeneratorRandom(GENERATOR *_gen, int _min, int _max); // both limits included
+
+double MazeTime(void); // monotonic clock in seconds
+
+//--------------------------------------------------------------------------------------------
+// GRID
+//--------------------------------------------------------------------------------------------
+
+typedef struct
+{
+	int cell;
+	int next; // next item of the same depth bucket
+} FLOODITEM;
+
+// Structure of arrays, one layer per cell property. Coordinates are not stored, they are
+// computed from the cell index on demand.
+typedef struct
+{
+	int width;
+	int height;
+	int size;
+	int bonus;
+	unsigned char *types; // CT_* tile type, corridors are CT_OPEN
+	int *dists; // carve distance of the corridor cells
+	unsigned char *masks; // walkable neighbors, a bit per offsets8 direction
+	signed char *depths; // visibility depth, MAZE_VISIBILITY_MIN..MAZE_VISIBILITY_MAX, visible above 0
+	unsigned short *stamps; // generation of the last visibility flood that reached the cell
+	unsigned short stamp; // current visibility flood generation
+	int viewer; // cell the current visibility flood spreads from
+	int viewerDepth;
+	int planeWords; // 64 bit words of a bit plane row
+	unsigned long long *planes; // GridMaze scratch bit planes, a bit per cell
+	void *memory; // the allocation of the layers owned by the grid
+	FLOODITEM *floodQueue; // bucket queue storage of the visibility flood, allocated on first use
+	int cellOffsets4[4];
+	int cellOffsets8[8];
+} GRID;
+
+enum CellTypes
+{
+	CT_UNVISITED = 0,
+	CT_WALL,
+	CT_START,
+	CT_END_TEMP,
+	CT_END,
+	CT_ROOM_CENTER,
+	CT_ROOM_BORDER,
+	CT_DOOR,
+	CT_BONUS,
+	CT_MARK,
+	CT_LAST_COLOR,
+	CT_OPEN
+};
+
+enum GridDirections {
+	GRID_RIGHT,
+	GRID_UP,
+	GRID_LEFT,
+	GRID_DOWN
+};
+
+GRID *GridCreate(int _width, int _height); // NULL when out of memory
+GRID *GridCreateOver(int _width, int _height, int *_dists, unsigned char *_types, unsigned char *_masks); // grid over static layers owned by the caller, GridMaze can not run on it, NULL when out of memory or not odd sized
+size_t GridBytes(int _width, int _height); // memory GridCreate allocates, flood queue aside
+void GridRemove(GRID *_grid);
+GRID *GridFromId(const MAZEID *_id, int *_cellStart); // GridCreate and GridMaze of the maze the ID stands for, NULL when out of memory
+int GridMaze(GENERATOR *_gen, GRID *_grid); // returns the starting cell, the grid holds at least _gen->bonusMin bonuses when it has room for them
+void GridMasks(GRID *_grid); // walkable neighbors of every cell computed again from the types
+int GridTypesValid(int _width, int _height, const unsigned char *_types); // every type known and the border walled, so no flood leaves the grid
+int GridNeighborCount(GRID *_grid, int _cell); // walkable cells around
+void GridFloodVisibility(GRID *_grid, int _cell, int _depth);
+int GridVisibilityBegin(GRID *_grid, int _cell, int _depth); // new flood generation without flooding, returns the clamped depth
+void GridVisibilityOpen(GRID *_grid, int _cell); // call after a blocking cell turns walkable
+void GridVisibilityOpenCells(GRID *_grid, const int *_cells, int _count); // same for several cells at once
+
+#endif // MAZE_H
@@ -0,0 +1,253 @@
+/**********************************************************************************************
+*
+*   mazeaudio - offline soundtrack render and synthesis benchmark
+*
+*   Renders a part of the soundtrack alone, or the song of the game or its end with all their
+*   parts, straight through the mixer into a WAV file, no audio device involved. The noise
+*   is drawn from a generator seeded as the game does, so a seed always renders the same
+*   samples and their hash can be compared against a golden one. Without a length, the part
+*   plays once.
+*
+*   The benchmark synthesizes tones over the whole keyboard and noise bursts, creates and
+*   removes the soundtrack and renders the song, reporting samples per second of each.
+*
+*   usage: mazeaudio render <part|song|end> <file.wav> [seconds] [seed]
+*          mazeaudio bench [notes]
+*
+*   LICENSE: zlib/libpng
+*
+*   Copyright (c) 2020 Jose Miguel Rodriguez Chavarri (https://github.com/txesmi/)
+*
+**********************************************************************************************/
+
+#include "soundtrack.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//--------------------------------------------------------------------------------------------
+// DEFINES
+//--------------------------------------------------------------------------------------------
+
+#define AUDIO_SEED                2020u
+#define AUDIO_NOTES               20000 // synthesized by the benchmark
+#define AUDIO_TONE_LENGTH         1.0f
+#define AUDIO_SOUNDTRACKS         200 // created by the benchmark
+#define AUDIO_SONG_SECONDS        600 // rendered by the benchmark
+
+#define FNV_OFFSET                14695981039346656037ull
+#define FNV_PRIME                 1099511628211ull
+
+//--------------------------------------------------------------------------------------------
+// WAV
+//--------------------------------------------------------------------------------------------
+
+static void AudioPut(unsigned char **_out, unsigned int _value, int _bytes)
+{
+	for (int _i = 0; _i < _bytes; _i += 1, _value >>= 8)
+		*(*_out)++ = (unsigned char)(_value & 0xFF);
+}
+
+// 16 bits mono PCM, little endian whatever the machine
+static bool AudioSaveWav(const char *_path, const short *_samples, int _count, int _sampleRate)
+{
+	FILE *_file = fopen(_path, "wb");
+	if (_file == NULL)
+		return false;
+	unsigned char _header[44];
+	unsigned char *_out = _header;
+	unsigned int _bytes = (unsigned int)_count * 2u;
+	memcpy(_out, "RIFF", 4);
+	_out += 4;
+	AudioPut(&_out, 36u + _bytes, 4);
+	memcpy(_out, "WAVEfmt ", 8);
+	_out += 8;
+	AudioPut(&_out, 16, 4); // format chunk
+	AudioPut(&_out, 1, 2); // PCM
+	AudioPut(&_out, 1, 2); // channels
+	AudioPut(&_out, (unsigned int)_sampleRate, 4);
+	AudioPut(&_out, (unsigned int)_sampleRate * 2u, 4); // bytes per second
+	AudioPut(&_out, 2, 2); // bytes per frame
+	AudioPut(&_out, 16, 2); // bits
+	memcpy(_out, "data", 4);
+	_out += 4;
+	AudioPut(&_out, _bytes, 4);
+	bool _done = fwrite(_header, 1, sizeof(_header), _file) == sizeof(_header);
+
+	unsigned char _block[1024];
+	for (int _s = 0; _done && (_s < _count); )
+	{
+		int _n = 0;
+		for (; (_n < (int)sizeof(_block) / 2) && (_s < _count); _n += 1, _s += 1)
+		{
+			_block[_n * 2] = (unsigned char)((unsigned short)_samples[_s] & 0xFF);
+			_block[_n * 2 + 1] = (unsigned char)((unsigned short)_samples[_s] >> 8);
+		}
+		_done = fwrite(_block, 2, (size_t)_n, _file) == (size_t)_n;
+	}
+	return (fclose(_file) == 0) && _done;
+}
+
+//--------------------------------------------------------------------------------------------
+// AUDIO
+//--------------------------------------------------------------------------------------------
+
+// the same random stream of the noise the game derives from a seed
+static void AudioSynthInit(unsigned long long _seed)
+{
+	GENERATOR _noise;
+	GeneratorInit(&_noise, _seed);
+	GeneratorJump(&_noise);
+	SynthInit(&_noise);
+}
+
+static int AudioRender(const char *_name, const char *_path, float _seconds, unsigned long long _seed)
+{
+	// the song of the game is led by its high line, the end of the game by the high end
+	int _voice = (strcmp(_name, "song") == 0) ? VOICE_HIGH : (strcmp(_name, "end") == 0) ? VOICE_HIGH_END : SoundtrackVoice(_name);
+	if (_voice < 0)
+	{
+		printf("render: no part named %s\n", _name);
+		return 1;
+	}
+
+	AudioSynthInit(_seed);
+	MIXER _mixer;
+	MixerInit(&_mixer);
+	SOUNDTRACK _soundtrack;
+	if (!SoundtrackCreate(&_soundtrack, &_mixer))
+	{
+		printf("render: out of memory\n");
+		return 1;
+	}
+	int _count = (_seconds > 0) ? (int)(_seconds * (float)SYNTH_SAMPLE_RATE) : _mixer.voices[_voice].length;
+	short *_samples = (short*)malloc((size_t)(_count > 0 ? _count : 1) * sizeof(short));
+	if (_samples == NULL)
+	{
+		printf("render: out of memory\n");
+		SoundtrackRemove(&_soundtrack, &_mixer);
+		return 1;
+	}
+	if (_voice == SoundtrackVoice(_name))
+	{
+		for (int _v = 0; _v < SOUNDTRACK_VOICES; _v += 1)
+			MixerFollow(&_mixer, _v, -1); // the part alone
+	}
+	MixerPlay(&_mixer, _voice);
+	MixerRender(&_mixer, _samples, _count);
+	SoundtrackRemove(&_soundtrack, &_mixer);
+
+	unsigned long long _hash = FNV_OFFSET;
+	for (int _s = 0; _s < _count; _s += 1)
+		_hash = (_hash ^ (unsigned short)_samples[_s]) * FNV_PRIME;
+	bool _saved = AudioSaveWav(_path, _samples, _count, SYNTH_SAMPLE_RATE);
+	free(_samples);
+	if (!_saved)
+	{
+		printf("render: could not write %s\n", _path);
+		return 1;
+	}
+	printf("%s: %i samples, %.3f s at %i Hz, seed %llu, %016llx\n", _path, _count,
+		(double)_count / SYNTH_SAMPLE_RATE, SYNTH_SAMPLE_RATE, _seed, _hash);
+	return 0;
+}
+
+static void AudioReport(const char *_name, double _samples, double _seconds, const char *_extra)
+{
+	printf("%-12s %12.0f %10.3f %14.0f  %s\n", _name, _samples, _seconds,
+		(_seconds > 0) ? _samples / _seconds : 0.0, _extra);
+}
+
+static int AudioBench(int _notes)
+{
+	static short _wave[SYNTH_SAMPLES_MAX];
+	AudioSynthInit(AUDIO_SEED);
+	printf("%-12s %12s %10s %14s\n", "", "samples", "seconds", "samples/s");
+
+	// tones over the whole keyboard
+	double _samples = 0;
+	double _time = MazeTime();
+	for (int _n = 0; _n < _notes; _n += 1)
+	{
+		float _frequency = (float)SynthFrequency(MIDI_A0 + _n % (MIDI_C8 - MIDI_A0 + 1));
+		int _count = SynthToneSamples(_frequency, AUDIO_TONE_LENGTH);
+		SynthTone(_wave, _count, _frequency, 0.5f);
+		_samples += _count;
+	}
+	AudioReport("tone", _samples, MazeTime() - _time, "");
+
+	_samples = 0;
+	_time = MazeTime();
+	for (int _n = 0; _n < _notes; _n += 1)
+	{
+		int _count = SynthNoiseSamples(AUDIO_TONE_LENGTH);
+		SynthNoise(_wave, _count, 0.5f);
+		_samples += _count;
+	}
+	AudioReport("noise", _samples, MazeTime() - _time, "");
+
+	// each soundtrack synthesizes all its waves into an arena of its own
+	MIXER _mixer;
+	MixerInit(&_mixer);
+	SOUNDTRACK _soundtrack;
+	_samples = 0;
+	_time = MazeTime();
+	for (int _i = 0; _i < AUDIO_SOUNDTRACKS; _i += 1)
+	{
+		if (!SoundtrackCreate(&_soundtrack, &_mixer))
+		{
+			printf("bench: out of memory\n");
+			return 1;
+		}
+		_samples += _soundtrack.samples;
+		SoundtrackRemove(&_soundtrack, &_mixer);
+	}
+	char _extra[64];
+	snprintf(_extra, sizeof(_extra), "%i soundtracks of %i waves, %i KB", AUDIO_SOUNDTRACKS, _soundtrack.waves, _soundtrack.samples * (int)sizeof(short) / 1024);
+	AudioReport("melody", _samples, MazeTime() - _time, _extra);
+
+	// the song with its three parts
+	if (!SoundtrackCreate(&_soundtrack, &_mixer))
+	{
+		printf("bench: out of memory\n");
+		return 1;
+	}
+	short _block[MIXER_SPAN * 4];
+	int _count = AUDIO_SONG_SECONDS * SYNTH_SAMPLE_RATE;
+	MixerPlay(&_mixer, VOICE_HIGH);
+	_time = MazeTime();
+	for (int _s = 0; _s < _count; _s += (int)(sizeof(_block) / sizeof(short)))
+		MixerRender(&_mixer, _block, (int)(sizeof(_block) / sizeof(short)));
+	snprintf(_extra, sizeof(_extra), "%i s of the song", AUDIO_SONG_SECONDS);
+	AudioReport("mix", (double)_count, MazeTime() - _time, _extra);
+	SoundtrackRemove(&_soundtrack, &_mixer);
+	return 0;
+}
+
+static int AudioUsage(const char *_program)
+{
+	printf("usage: %s render <part|song|end> <file.wav> [seconds] [seed]\n", _program);
+	printf("       %s bench [notes]\n", _program);
+	printf("parts:");
+	for (int _v = 0; _v < SOUNDTRACK_VOICES; _v += 1)
+		printf(" %s", SoundtrackParts[_v].name);
+	printf("\n");
+	return 1;
+}
+
+int main(int argc, char **argv)
+{
+	if ((argc >= 4) && (argc <= 6) && (strcmp(argv[1], "render") == 0))
+	{
+		float _seconds = (argc > 4) ? (float)atof(argv[4]) : 0;
+		unsigned long long _seed = (argc > 5) ? strtoull(argv[5], NULL, 10) : AUDIO_SEED;
+		return AudioRender(argv[2], argv[3], _seconds, _seed);
+	}
+	if ((argc >= 2) && (argc <= 3) && (strcmp(argv[1], "bench") == 0))
+	{
+		int _notes = (argc > 2) ? atoi(argv[2]) : AUDIO_NOTES;
+		if (_notes > 0)
+			return AudioBench(_notes);
+	}
+	return AudioUsage(argv[0]);
+}
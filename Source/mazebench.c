@@ -0,0 +1,184 @@
+/**********************************************************************************************
+*
+*   mazebench - maze generation benchmark
+*
+*   Runs GridCreate + GridMaze + GridFloodVisibility with fixed seeds over every size
+*   selector preset of the game and over much larger grids, and reports mazes per second,
+*   nanoseconds per cell, peak resident memory, bonuses placed by repair and the cost of
+*   each GridMaze pass.
+*
+*   usage: mazebench [max side] [memory budget in MB] [seconds per size]
+*
+*   LICENSE: zlib/libpng
+*
+*   Copyright (c) 2020 Jose Miguel Rodriguez Chavarri (https://github.com/txesmi/)
+*
+**********************************************************************************************/
+
+#include "maze.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+//--------------------------------------------------------------------------------------------
+// DEFINES
+//--------------------------------------------------------------------------------------------
+
+#define BENCH_SELECTOR_MIN        2 // same range as the game size selector
+#define BENCH_SELECTOR_MAX        8
+#define BENCH_SEED                2020u // seed of the first maze of every size
+#define BENCH_MAX_SIDE            16384
+#define BENCH_BUDGET_MB           4096
+#define BENCH_SECONDS             1.0
+
+static const int largeSides[] = { 1024, 4096, 16384 };
+
+static const char *passNames[MAZE_PASS_COUNT] =
+{
+	"carve",
+	"near",
+	"walls",
+	"start",
+	"count",
+	"border",
+	"rdoor",
+	"xdoor",
+	"cbonus",
+	"rbonus",
+	"split",
+	"repair"
+};
+
+//--------------------------------------------------------------------------------------------
+// BENCH
+//--------------------------------------------------------------------------------------------
+
+static double PeakMemoryMB(void)
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS _counters;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &_counters, sizeof(_counters)))
+		return 0;
+	return (double)_counters.PeakWorkingSetSize / (1024.0 * 1024.0);
+#else
+	struct rusage _usage;
+	if (getrusage(RUSAGE_SELF, &_usage) != 0)
+		return 0;
+#ifdef __APPLE__
+	return (double)_usage.ru_maxrss / (1024.0 * 1024.0); // bytes
+#else
+	return (double)_usage.ru_maxrss / 1024.0; // kilobytes
+#endif
+#endif
+}
+
+static void BenchSize(const char *_name, int _width, int _height, double _budgetMB, double _seconds)
+{
+	double _cellsMB = (double)_width * (double)_height * GRID_CELL_BYTES / (1024.0 * 1024.0);
+	if (_cellsMB > _budgetMB)
+	{
+		printf("%-8s %5ix%-5i skipped, %.0f MB of cells over the budget\n", _name, _width, _height, _cellsMB);
+		return;
+	}
+
+	MAZE_STATS _stats;
+	memset(&_stats, 0, sizeof(_stats));
+	double _createTime = 0;
+	double _mazeTime = 0;
+	double _floodTime = 0;
+	double _cells = 0;
+	int _count = 0;
+
+	double _begin = MazeTime();
+	do
+	{
+		GENERATOR _gen;
+		GeneratorInit(&_gen, BENCH_SEED + _count);
+		_gen.stats = &_stats;
+
+		double _t0 = MazeTime();
+		GRID *_grid = GridCreate(_width, _height);
+		if (_grid == NULL)
+		{
+			printf("%-8s %5ix%-5i skipped, out of memory\n", _name, _width, _height);
+			return;
+		}
+		double _t1 = MazeTime();
+		int _start = GridMaze(&_gen, _grid);
+		double _t2 = MazeTime();
+		GridFloodVisibility(_grid, _start, MAZE_VISIBILITY_MAX);
+		double _t3 = MazeTime();
+
+		_createTime += _t1 - _t0;
+		_mazeTime += _t2 - _t1;
+		_floodTime += _t3 - _t2;
+		_cells += _grid->size;
+		_count += 1;
+
+		GridRemove(_grid);
+	} while (MazeTime() - _begin < _seconds);
+
+	double _total = _createTime + _mazeTime + _floodTime;
+	printf("%-8s %5ix%-5i %6i %10.2f %8.2f %10.3f %10.3f %9.1f %6i %8.1f\n",
+		_name, _width, _height, _count,
+		(double)_count / _total,
+		_total * 1e9 / _cells,
+		_createTime * 1e3 / _count,
+		_mazeTime * 1e3 / _count,
+		_floodTime * 1e6 / _count,
+		_stats.repairs,
+		PeakMemoryMB());
+
+	// GridMaze passes, ns per cell
+	printf("         ");
+	for (int _pass = 0; _pass < MAZE_PASS_COUNT; _pass += 1)
+		printf(" %s %.2f", passNames[_pass], _stats.passTime[_pass] * 1e9 / _cells);
+	printf("\n");
+}
+
+int main(int argc, char **argv)
+{
+	int _maxSide = BENCH_MAX_SIDE;
+	double _budgetMB = BENCH_BUDGET_MB;
+	double _seconds = BENCH_SECONDS;
+	if (argc > 1)
+		_maxSide = atoi(argv[1]);
+	if (argc > 2)
+		_budgetMB = atof(argv[2]);
+	if (argc > 3)
+		_seconds = atof(argv[3]);
+	if ((argc > 4) || (_maxSide <= 0) || (_budgetMB <= 0) || (_seconds < 0))
+	{
+		printf("usage: %s [max side] [memory budget in MB] [seconds per size]\n", argv[0]);
+		return 1;
+	}
+
+	printf("%-8s %11s %6s %10s %8s %10s %10s %9s %6s %8s\n",
+		"size", "cells", "mazes", "mazes/s", "ns/cell", "create ms", "maze ms", "flood us", "repair", "peak MB");
+
+	for (int _selector = BENCH_SELECTOR_MIN; _selector <= BENCH_SELECTOR_MAX; _selector += 1)
+	{
+		int _side = 11 + (1 << _selector); // GameMazeCreate size with a square proportion
+		char _name[16];
+		sprintf(_name, "sel %i", _selector);
+		BenchSize(_name, _side, _side, _budgetMB, _seconds);
+	}
+
+	for (int _i = 0; _i < (int)(sizeof(largeSides) / sizeof(largeSides[0])); _i += 1)
+	{
+		if (largeSides[_i] > _maxSide)
+			break;
+		char _name[16];
+		sprintf(_name, "%ik", largeSides[_i] / 1024);
+		BenchSize(_name, largeSides[_i], largeSides[_i], _budgetMB, _seconds);
+	}
+
+	return 0;
+}
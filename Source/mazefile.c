@@ -0,0 +1,211 @@
+/**********************************************************************************************
+*
+*   mazefile - binary maze files mapped in memory
+*
+*   LICENSE: zlib/libpng
+*
+*   Copyright (c) 2020 Jose Miguel Rodriguez Chavarri (https://github.com/txesmi/)
+*
+**********************************************************************************************/
+
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200112L // mmap
+#endif
+
+#include "mazefile.h"
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define ALIGNUP(x, a) (((x) + (a) - 1) / (a) * (a))
+
+// the header has no implicit padding, so its layout is the same on every ABI
+typedef char MazeFileHeaderCheck[(sizeof(MAZEFILEHEADER) == 96) ? 1 : -1];
+
+//--------------------------------------------------------------------------------------------
+// SAVE
+//--------------------------------------------------------------------------------------------
+
+static int MazeFileWrite(FILE *_stream, const void *_data, size_t _bytes, unsigned long long *_written)
+{
+	static const char _zeros[MAZEFILE_ALIGN] = { 0 };
+	size_t _pad = (size_t)(ALIGNUP(*_written, MAZEFILE_ALIGN) - *_written);
+	if ((_pad > 0) && (fwrite(_zeros, 1, _pad, _stream) != _pad))
+		return 0;
+	if (fwrite(_data, 1, _bytes, _stream) != _bytes)
+		return 0;
+	*_written += _pad + _bytes;
+	return 1;
+}
+
+int MazeFileSave(const char *_path, const GRID *_grid, const MAZEID *_id, int _cellStart)
+{
+	MAZEFILEHEADER _header;
+	memset(&_header, 0, sizeof(_header));
+	memcpy(_header.magic, MAZEFILE_MAGIC, sizeof(_header.magic));
+	_header.version = MAZEFILE_VERSION;
+	_header.byteOrder = MAZEFILE_BYTE_ORDER;
+	if (_id != NULL)
+	{
+		_header.idSeed = _id->seed;
+		_header.idWidth = _id->width;
+		_header.idHeight = _id->height;
+		_header.idBonusMin = _id->bonusMin;
+	}
+	_header.width = _grid->width;
+	_header.height = _grid->height;
+	_header.bonus = _grid->bonus;
+	_header.cellStart = _cellStart;
+	_header.cellEnd = -1;
+	for (int _cell = 0; _cell < _grid->size; _cell += 1)
+	{
+		if (_grid->types[_cell] == CT_END)
+		{
+			_header.cellEnd = _cell;
+			break;
+		}
+	}
+
+	// the widest layer first, every one of them starting on a cache line
+	size_t _size = (size_t)_grid->size;
+	_header.distsOffset = ALIGNUP(sizeof(MAZEFILEHEADER), MAZEFILE_ALIGN);
+	_header.typesOffset = ALIGNUP(_header.distsOffset + _size * sizeof(int), MAZEFILE_ALIGN);
+	_header.masksOffset = ALIGNUP(_header.typesOffset + _size, MAZEFILE_ALIGN);
+	_header.fileBytes = _header.masksOffset + _size;
+
+	FILE *_stream = fopen(_path, "wb");
+	if (_stream == NULL)
+		return 0;
+	unsigned long long _written = 0;
+	int _ok = MazeFileWrite(_stream, &_header, sizeof(_header), &_written)
+		&& MazeFileWrite(_stream, _grid->dists, _size * sizeof(int), &_written)
+		&& MazeFileWrite(_stream, _grid->types, _size, &_written)
+		&& MazeFileWrite(_stream, _grid->masks, _size, &_written);
+	if (fclose(_stream) != 0)
+		_ok = 0;
+	if (!_ok)
+		remove(_path);
+	return _ok;
+}
+
+//--------------------------------------------------------------------------------------------
+// OPEN
+//--------------------------------------------------------------------------------------------
+
+// the header describes a grid that lies inside the mapping, with known tile types and a walled border
+static int MazeFileValid(const MAZEFILEHEADER *_header, size_t _mapBytes)
+{
+	if (memcmp(_header->magic, MAZEFILE_MAGIC, sizeof(_header->magic)) != 0)
+		return 0;
+	if ((_header->version != MAZEFILE_VERSION) || (_header->byteOrder != MAZEFILE_BYTE_ORDER))
+		return 0;
+	if ((_header->width < 7) || (_header->height < 7) || (_header->width % 2 == 0) || (_header->height % 2 == 0))
+		return 0;
+	if (_header->width > INT_MAX / _header->height)
+		return 0;
+	unsigned long long _size = (unsigned long long)_header->width * (unsigned long long)_header->height;
+	if ((_header->cellStart < 0) || ((unsigned long long)_header->cellStart >= _size))
+		return 0;
+	if ((_header->cellEnd < -1) || ((_header->cellEnd >= 0) && ((unsigned long long)_header->cellEnd >= _size)))
+		return 0;
+	if ((_header->distsOffset % sizeof(int) != 0) || (_header->fileBytes > _mapBytes))
+		return 0;
+	if ((_header->distsOffset < sizeof(MAZEFILEHEADER)) || (_header->distsOffset > _header->fileBytes) || (_header->fileBytes - _header->distsOffset < _size * sizeof(int)))
+		return 0;
+	if ((_header->typesOffset > _header->fileBytes) || (_header->fileBytes - _header->typesOffset < _size))
+		return 0;
+	if ((_header->masksOffset > _header->fileBytes) || (_header->fileBytes - _header->masksOffset < _size))
+		return 0;
+	return GridTypesValid(_header->width, _header->height, (const unsigned char*)_header + _header->typesOffset);
+}
+
+MAZEFILE *MazeFileOpen(const char *_path)
+{
+	void *_map = NULL;
+	size_t _mapBytes = 0;
+
+#ifdef _WIN32
+	HANDLE _fileHandle = CreateFileA(_path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (_fileHandle == INVALID_HANDLE_VALUE)
+		return NULL;
+	LARGE_INTEGER _fileSize;
+	if (GetFileSizeEx(_fileHandle, &_fileSize) && (_fileSize.QuadPart >= (LONGLONG)sizeof(MAZEFILEHEADER)) && ((unsigned long long)_fileSize.QuadPart <= (size_t)-1))
+	{
+		HANDLE _mapHandle = CreateFileMappingA(_fileHandle, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+		if (_mapHandle != NULL)
+		{
+			_map = MapViewOfFile(_mapHandle, FILE_MAP_COPY, 0, 0, 0);
+			_mapBytes = (size_t)_fileSize.QuadPart;
+			CloseHandle(_mapHandle); // the view keeps the mapping
+		}
+	}
+	CloseHandle(_fileHandle);
+	if (_map == NULL)
+		return NULL;
+#else
+	int _fd = open(_path, O_RDONLY);
+	if (_fd < 0)
+		return NULL;
+	struct stat _stat;
+	if ((fstat(_fd, &_stat) == 0) && (_stat.st_size >= (off_t)sizeof(MAZEFILEHEADER)) && ((unsigned long long)_stat.st_size <= (size_t)-1))
+	{
+		_mapBytes = (size_t)_stat.st_size;
+		_map = mmap(NULL, _mapBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE, _fd, 0);
+		if (_map == MAP_FAILED)
+			_map = NULL;
+	}
+	close(_fd); // the mapping keeps the file
+	if (_map == NULL)
+		return NULL;
+#endif
+
+	MAZEFILE *_file = (MAZEFILE*)malloc(sizeof(MAZEFILE));
+	const MAZEFILEHEADER *_header = (const MAZEFILEHEADER*)_map;
+	if ((_file == NULL) || !MazeFileValid(_header, _mapBytes))
+	{
+		free(_file);
+#ifdef _WIN32
+		UnmapViewOfFile(_map);
+#else
+		munmap(_map, _mapBytes);
+#endif
+		return NULL;
+	}
+
+	_file->header = _header;
+	_file->dists = (int*)((char*)_map + _header->distsOffset);
+	_file->types = (unsigned char*)_map + _header->typesOffset;
+	_file->masks = (unsigned char*)_map + _header->masksOffset;
+	_file->map = _map;
+	_file->mapBytes = _mapBytes;
+	return _file;
+}
+
+void MazeFileClose(MAZEFILE *_file)
+{
+#ifdef _WIN32
+	UnmapViewOfFile(_file->map);
+#else
+	munmap(_file->map, _file->mapBytes);
+#endif
+	free(_file);
+}
+
+GRID *MazeFileGrid(MAZEFILE *_file)
+{
+	GRID *_grid = GridCreateOver(_file->header->width, _file->header->height, _file->dists, _file->types, _file->masks);
+	if (_grid != NULL)
+		_grid->bonus = _file->header->bonus;
+	return _grid;
+}
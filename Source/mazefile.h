@@ -0,0 +1,74 @@
+/**********************************************************************************************
+*
+*   mazefile - binary maze files mapped in memory
+*
+*   A maze file holds a versioned header followed by the static layers of a grid, each one
+*   aligned to a cache line, laid out as they are in memory. Opening a file maps it
+*   copy-on-write instead of reading it, so a maze is ready without parsing or copying and
+*   pages are only loaded when touched. Writes to the mapped layers, like opened doors or
+*   collected bonuses, stay in the process and never reach the file.
+*
+*   Files are written in the byte order of the machine and rejected on another one.
+*
+*   LICENSE: zlib/libpng
+*
+*   Copyright (c) 2020 Jose Miguel Rodriguez Chavarri (https://github.com/txesmi/)
+*
+**********************************************************************************************/
+
+#ifndef MAZEFILE_H
+#define MAZEFILE_H
+
+#include "maze.h"
+
+//--------------------------------------------------------------------------------------------
+// DEFINES
+//--------------------------------------------------------------------------------------------
+
+#define MAZEFILE_MAGIC            "MAZEGRID"
+#define MAZEFILE_VERSION          1
+#define MAZEFILE_BYTE_ORDER       0x01020304u
+#define MAZEFILE_ALIGN            64
+
+//--------------------------------------------------------------------------------------------
+// MAZEFILE
+//--------------------------------------------------------------------------------------------
+
+typedef struct
+{
+	char magic[8];
+	unsigned int version;
+	unsigned int byteOrder; // MAZEFILE_BYTE_ORDER as written by the machine
+	unsigned long long idSeed; // generator parameters field by field, MAZEID padding differs between ABIs
+	int idWidth; // zero when the maze does not come from an ID
+	int idHeight;
+	int idBonusMin;
+	int idPad;
+	int width;
+	int height;
+	int bonus;
+	int cellStart;
+	int cellEnd; // -1 when the maze has no end
+	int reserved;
+	unsigned long long distsOffset; // layer offsets from the start of the file
+	unsigned long long typesOffset;
+	unsigned long long masksOffset;
+	unsigned long long fileBytes;
+} MAZEFILEHEADER;
+
+typedef struct
+{
+	const MAZEFILEHEADER *header;
+	int *dists; // mapped layers, writable copy-on-write
+	unsigned char *types;
+	unsigned char *masks;
+	void *map;
+	size_t mapBytes;
+} MAZEFILE;
+
+int MazeFileSave(const char *_path, const GRID *_grid, const MAZEID *_id, int _cellStart); // _id may be NULL, 0 on failure
+MAZEFILE *MazeFileOpen(const char *_path); // NULL when missing, truncated, or of another version or byte order
+void MazeFileClose(MAZEFILE *_file);
+GRID *MazeFileGrid(MAZEFILE *_file); // grid over the mapped layers with its own visibility layers, the file must outlive it and GridMaze can not run on it
+
+#endif // MAZEFILE_H
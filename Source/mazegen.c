@@ -0,0 +1,196 @@
+/**********************************************************************************************
+*
+*   mazegen - parallel batch maze generation
+*
+*   Generates the same batch of mazes with BatchRun on 1, 2, 4... threads up to every core
+*   and reports mazes per second, the speedup over a single thread, the chunks stolen
+*   between workers and the grids created. The hash of the mazes, taken in emission order,
+*   must be the same for every thread count, any mismatch fails the run.
+*
+*   With a directory, the batch is saved there as maze files and mapped back, and the time
+*   to map every file is reported next to the time to generate them.
+*
+*   usage: mazegen [mazes] [width] [height] [seed] [directory]
+*
+*   LICENSE: zlib/libpng
+*
+*   Copyright (c) 2020 Jose Miguel Rodriguez Chavarri (https://github.com/txesmi/)
+*
+**********************************************************************************************/
+
+#include "batch.h"
+#include "mazefile.h"
+#include "thread.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+//--------------------------------------------------------------------------------------------
+// DEFINES
+//--------------------------------------------------------------------------------------------
+
+#define GEN_MAZES                 2000
+#define GEN_SIDE                  75 // GameMazeCreate size of the selector 6 with a square proportion
+#define GEN_SEED                  2020u
+#define GEN_BONUS_MIN             1
+
+#define FNV_OFFSET                14695981039346656037ull
+#define FNV_PRIME                 1099511628211ull
+
+//--------------------------------------------------------------------------------------------
+// GEN
+//--------------------------------------------------------------------------------------------
+
+typedef struct
+{
+	unsigned long long hash;
+	int next; // index expected by the next emission
+	int unordered;
+} GENHASH;
+
+static void GenHash(GENHASH *_hash, const unsigned char *_types, int _size, int _cellStart)
+{
+	unsigned long long _h = _hash->hash;
+	_h = (_h ^ (unsigned long long)_cellStart) * FNV_PRIME;
+	for (int _cell = 0; _cell < _size; _cell += 1)
+		_h = (_h ^ _types[_cell]) * FNV_PRIME;
+	_hash->hash = _h;
+}
+
+static void GenEmit(void *_user, int _index, const MAZEID *_id, GRID *_grid, int _cellStart)
+{
+	GENHASH *_hash = (GENHASH*)_user;
+	(void)_id;
+	if (_index != _hash->next)
+		_hash->unordered += 1;
+	_hash->next = _index + 1;
+	GenHash(_hash, _grid->types, _grid->size, _cellStart);
+}
+
+typedef struct
+{
+	GENHASH hash;
+	const char *directory;
+	int failed;
+} GENSAVE;
+
+static void GenPath(char *_path, size_t _bytes, const char *_directory, unsigned long long _seed)
+{
+	snprintf(_path, _bytes, "%s/%llu.maze", _directory, _seed);
+}
+
+static void GenSave(void *_user, int _index, const MAZEID *_id, GRID *_grid, int _cellStart)
+{
+	GENSAVE *_save = (GENSAVE*)_user;
+	GenEmit(&_save->hash, _index, _id, _grid, _cellStart);
+	char _path[1024];
+	GenPath(_path, sizeof(_path), _save->directory, _id->seed);
+	if (!MazeFileSave(_path, _grid, _id, _cellStart))
+		_save->failed += 1;
+}
+
+// saves the batch and maps it back, both hashes must match
+static int GenFiles(const MAZEID *_first, int _mazes, const char *_directory)
+{
+	GENSAVE _save = { { FNV_OFFSET, 0, 0 }, _directory, 0 };
+	BATCH _batch = { *_first, _mazes, 0, 0, GenSave, &_save };
+	BATCHSTATS _stats;
+	if (!BatchRun(&_batch, &_stats) || (_save.failed > 0))
+	{
+		printf("files: could not save the mazes into %s\n", _directory);
+		return 0;
+	}
+
+	GENHASH _hash = { FNV_OFFSET, 0, 0 };
+	int _failed = 0;
+	double _time = MazeTime();
+	for (int _i = 0; _i < _mazes; _i += 1)
+	{
+		char _path[1024];
+		GenPath(_path, sizeof(_path), _directory, _first->seed + (unsigned long long)_i);
+		MAZEFILE *_file = MazeFileOpen(_path);
+		GRID *_grid = (_file != NULL) ? MazeFileGrid(_file) : NULL;
+		if (_grid == NULL)
+			_failed += 1;
+		else
+		{
+			GenHash(&_hash, _grid->types, _grid->size, _file->header->cellStart);
+			GridRemove(_grid);
+		}
+		if (_file != NULL)
+			MazeFileClose(_file);
+	}
+	_time = MazeTime() - _time;
+
+	printf("files: %i generated and saved in %.3f s, mapped in %.3f s, %016llx %016llx%s\n",
+		_mazes, _stats.seconds, _time, _save.hash.hash, _hash.hash,
+		((_failed > 0) || (_hash.hash != _save.hash.hash) || (_save.hash.unordered > 0)) ? " mismatch" : "");
+	return (_failed == 0) && (_hash.hash == _save.hash.hash) && (_save.hash.unordered == 0);
+}
+
+// the hash must match the one of a single thread, emitted in order
+static int GenRun(const MAZEID *_first, int _mazes, int _threads, double _baseRate, unsigned long long _baseHash)
+{
+	GENHASH _hash = { FNV_OFFSET, 0, 0 };
+	BATCH _batch = { *_first, _mazes, _threads, 0, GenEmit, &_hash };
+	BATCHSTATS _stats;
+	if (!BatchRun(&_batch, &_stats))
+	{
+		printf("%7i out of memory\n", _threads);
+		return 0;
+	}
+
+	double _rate = _stats.seconds > 0 ? (double)_mazes / _stats.seconds : 0;
+	printf("%7i %10.1f %8.2f %7i %6i %016llx%s%s\n",
+		_stats.threads, _rate,
+		_baseRate > 0 ? _rate / _baseRate : 1.0,
+		_stats.steals, _stats.grids, _hash.hash,
+		_hash.hash != _baseHash ? " mismatch" : "",
+		_hash.unordered > 0 ? " unordered" : "");
+	return (_hash.hash == _baseHash) && (_hash.unordered == 0);
+}
+
+int main(int argc, char **argv)
+{
+	int _mazes = GEN_MAZES;
+	MAZEID _first = { GEN_SEED, GEN_SIDE, GEN_SIDE, GEN_BONUS_MIN };
+	if (argc > 1)
+		_mazes = atoi(argv[1]);
+	if (argc > 2)
+		_first.width = atoi(argv[2]);
+	if (argc > 3)
+		_first.height = atoi(argv[3]);
+	if (argc > 4)
+		_first.seed = strtoull(argv[4], NULL, 10);
+	const char *_directory = (argc > 5) ? argv[5] : NULL;
+	if ((argc > 6) || (_mazes <= 0) || (_first.width < 9) || (_first.height < 9))
+	{
+		printf("usage: %s [mazes] [width] [height] [seed] [directory]\n", argv[0]);
+		return 1;
+	}
+
+	int _cores = ThreadHardwareCount();
+	printf("%i mazes of %ix%i from seed %llu on %i cores\n", _mazes, _first.width, _first.height, _first.seed, _cores);
+	printf("%7s %10s %8s %7s %6s %16s\n", "threads", "mazes/s", "speedup", "steals", "grids", "hash");
+
+	// the single thread rate is the base of the speedup
+	GENHASH _hash = { FNV_OFFSET, 0, 0 };
+	BATCH _batch = { _first, _mazes, 1, 0, GenEmit, &_hash };
+	BATCHSTATS _stats;
+	if (!BatchRun(&_batch, &_stats) || (_hash.unordered > 0))
+	{
+		printf(_hash.unordered > 0 ? "unordered\n" : "out of memory\n");
+		return 1;
+	}
+	double _baseRate = _stats.seconds > 0 ? (double)_mazes / _stats.seconds : 0;
+
+	// every thread count runs even after a mismatch, the exit status reports any of them
+	int _matched = 1;
+	for (int _threads = 1; _threads < _cores; _threads *= 2)
+		_matched &= GenRun(&_first, _mazes, _threads, _baseRate, _hash.hash);
+	_matched &= GenRun(&_first, _mazes, _cores, _baseRate, _hash.hash);
+
+	if ((_directory != NULL) && !GenFiles(&_first, _mazes, _directory))
+		_matched = 0;
+
+	return _matched ? 0 : 1;
+}
@@ -0,0 +1,221 @@
+/**********************************************************************************************
+*
+*   mazepack - maze archive compression benchmark
+*
+*   Generates a batch of mazes with BatchRun and encodes them as archive records, reporting
+*   the bits stored per cell, the ratio against the tile types and against whole grids, and
+*   the encoding and decoding speed in MB of tile types per second. Every maze is decoded
+*   back and compared against the generated one.
+*
+*   With a path, the batch is written there as an archive, opened again, and every maze is
+*   read back in a random order by its ID.
+*
+*   usage: mazepack [mazes] [width] [height] [seed] [archive]
+*
+*   LICENSE: zlib/libpng
+*
+*   Copyright (c) 2020 Jose Miguel Rodriguez Chavarri (https://github.com/txesmi/)
+*
+**********************************************************************************************/
+
+#include "archive.h"
+#include "batch.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//--------------------------------------------------------------------------------------------
+// DEFINES
+//--------------------------------------------------------------------------------------------
+
+#define PACK_MAZES                2000
+#define PACK_SIDE                 75
+#define PACK_SEED                 2020u
+#define PACK_BONUS_MIN            1
+#define PACK_MB                   (1024.0 * 1024.0)
+
+//--------------------------------------------------------------------------------------------
+// PACK
+//--------------------------------------------------------------------------------------------
+
+typedef struct
+{
+	int size; // cells per maze
+	unsigned char *types; // tile types of every maze, one after the other
+	int *bonuses;
+	int *starts;
+} PACKMAZES;
+
+static void PackEmit(void *_user, int _index, const MAZEID *_id, GRID *_grid, int _cellStart)
+{
+	PACKMAZES *_mazes = (PACKMAZES*)_user;
+	(void)_id;
+	memcpy(_mazes->types + (size_t)_index * (size_t)_mazes->size, _grid->types, (size_t)_mazes->size);
+	_mazes->bonuses[_index] = _grid->bonus;
+	_mazes->starts[_index] = _cellStart;
+}
+
+// the maze of the grid differs from the generated one
+static int PackDiffers(const PACKMAZES *_mazes, int _index, const GRID *_grid, int _cellStart)
+{
+	return (_grid->size != _mazes->size) || (_grid->bonus != _mazes->bonuses[_index]) || (_cellStart != _mazes->starts[_index])
+		|| (memcmp(_grid->types, _mazes->types + (size_t)_index * (size_t)_mazes->size, (size_t)_mazes->size) != 0);
+}
+
+// writes the archive and reads every maze back by its ID in a random order
+static int PackArchive(const PACKMAZES *_mazes, GRID *_source, const MAZEID *_first, int _count, const char *_path)
+{
+	ARCHIVE *_archive = ArchiveCreate(_path);
+	int _ok = (_archive != NULL);
+	for (int _i = 0; _ok && (_i < _count); _i += 1)
+	{
+		MAZEID _id = *_first;
+		_id.seed += (unsigned long long)_i;
+		_source->types = _mazes->types + (size_t)_i * (size_t)_mazes->size;
+		_source->bonus = _mazes->bonuses[_i];
+		_ok = ArchiveAdd(_archive, &_id, _source, _mazes->starts[_i]);
+	}
+	if ((_archive != NULL) && !ArchiveFinish(_archive))
+		_ok = 0;
+	_archive = _ok ? ArchiveOpen(_path) : NULL;
+	if (_archive == NULL)
+	{
+		printf("archive: could not write %s\n", _path);
+		return 0;
+	}
+
+	int *_order = (int*)malloc((size_t)_count * sizeof(int));
+	if (_order == NULL)
+	{
+		ArchiveClose(_archive);
+		printf("out of memory\n");
+		return 0;
+	}
+	GENERATOR _gen;
+	GeneratorInit(&_gen, _first->seed);
+	for (int _i = 0; _i < _count; _i += 1)
+		_order[_i] = _i;
+	for (int _i = _count - 1; _i > 0; _i -= 1)
+	{
+		int _j = GeneratorRandom(&_gen, 0, _i);
+		int _swap = _order[_i];
+		_order[_i] = _order[_j];
+		_order[_j] = _swap;
+	}
+
+	int _failed = 0;
+	double _time = MazeTime();
+	for (int _i = 0; _i < _count; _i += 1)
+	{
+		MAZEID _id = *_first;
+		_id.seed += (unsigned long long)_order[_i];
+		int _cellStart = -1;
+		GRID *_grid = ArchiveGrid(_archive, ArchiveFind(_archive, &_id), &_cellStart);
+		if ((_grid == NULL) || PackDiffers(_mazes, _order[_i], _grid, _cellStart))
+			_failed += 1;
+		if (_grid != NULL)
+			GridRemove(_grid);
+	}
+	_time = MazeTime() - _time;
+
+	unsigned long long _bytes = sizeof(ARCHIVEHEADER) + (unsigned long long)_archive->count * sizeof(ARCHIVEENTRY);
+	for (int _i = 0; _i < _archive->count; _i += 1)
+		_bytes += _archive->entries[_i].bytes;
+	printf("archive: %i mazes in %.2f MB, %i random reads in %.3f s, %.0f mazes/s%s\n",
+		_archive->count, (double)_bytes / PACK_MB,
+		_count, _time, _time > 0 ? (double)_count / _time : 0, _failed > 0 ? " mismatch" : "");
+	ArchiveClose(_archive);
+	free(_order);
+	return _failed == 0;
+}
+
+int main(int argc, char **argv)
+{
+	int _count = PACK_MAZES;
+	MAZEID _first = { PACK_SEED, PACK_SIDE, PACK_SIDE, PACK_BONUS_MIN };
+	if (argc > 1)
+		_count = atoi(argv[1]);
+	if (argc > 2)
+		_first.width = atoi(argv[2]);
+	if (argc > 3)
+		_first.height = atoi(argv[3]);
+	if (argc > 4)
+		_first.seed = strtoull(argv[4], NULL, 10);
+	const char *_path = (argc > 5) ? argv[5] : NULL;
+	if ((argc > 6) || (_count <= 0) || (_first.width < 9) || (_first.height < 9) || (_first.width % 2 == 0) || (_first.height % 2 == 0))
+	{
+		printf("usage: %s [mazes] [odd width] [odd height] [seed] [archive]\n", argv[0]);
+		return 1;
+	}
+
+	PACKMAZES _mazes;
+	_mazes.size = _first.width * _first.height;
+	size_t _raw = (size_t)_count * (size_t)_mazes.size;
+	size_t _bound = ArchiveBound(_first.width, _first.height);
+	_mazes.types = (unsigned char*)malloc(_raw);
+	_mazes.bonuses = (int*)malloc((size_t)_count * sizeof(int));
+	_mazes.starts = (int*)malloc((size_t)_count * sizeof(int));
+	unsigned char *_packed = (unsigned char*)malloc((size_t)_count * _bound);
+	size_t *_sizes = (size_t*)malloc((size_t)_count * sizeof(size_t));
+	unsigned char *_dummy = (unsigned char*)malloc((size_t)_mazes.size);
+	// the source grid lies over the generated layers, moved from maze to maze
+	GRID *_source = (_dummy != NULL) ? GridCreateOver(_first.width, _first.height, NULL, _dummy, _dummy) : NULL;
+	GRID *_grid = GridCreate(_first.width, _first.height);
+	BATCH _batch = { _first, _count, 0, 0, PackEmit, &_mazes };
+	BATCHSTATS _stats;
+	if ((_mazes.types == NULL) || (_mazes.bonuses == NULL) || (_mazes.starts == NULL) || (_packed == NULL) || (_sizes == NULL)
+		|| (_source == NULL) || (_grid == NULL) || !BatchRun(&_batch, &_stats))
+	{
+		printf("out of memory\n");
+		return 1;
+	}
+	printf("%i mazes of %ix%i from seed %llu generated in %.3f s\n", _count, _first.width, _first.height, _first.seed, _stats.seconds);
+
+	size_t _total = 0;
+	double _encode = MazeTime();
+	for (int _i = 0; _i < _count; _i += 1)
+	{
+		_source->types = _mazes.types + (size_t)_i * (size_t)_mazes.size;
+		_source->bonus = _mazes.bonuses[_i];
+		_sizes[_i] = ArchiveEncode(_source, _mazes.starts[_i], _packed + (size_t)_i * _bound);
+		_total += _sizes[_i];
+	}
+	_encode = MazeTime() - _encode;
+
+	int _failed = 0;
+	double _decode = MazeTime();
+	for (int _i = 0; _i < _count; _i += 1)
+	{
+		if (!ArchiveDecode(_packed + (size_t)_i * _bound, _sizes[_i], _grid, NULL))
+			_failed += 1;
+	}
+	_decode = MazeTime() - _decode;
+
+	for (int _i = 0; _i < _count; _i += 1)
+	{
+		int _cellStart = -1;
+		if (!ArchiveDecode(_packed + (size_t)_i * _bound, _sizes[_i], _grid, &_cellStart) || PackDiffers(&_mazes, _i, _grid, _cellStart))
+			_failed += 1;
+	}
+
+	printf("%.2f bits per cell, %.2f MB of tile types in %.2f MB, %.1fx smaller than the types, %.1fx than the grids\n",
+		8.0 * (double)_total / (double)_raw, (double)_raw / PACK_MB, (double)_total / PACK_MB,
+		(double)_raw / (double)_total, (double)GridBytes(_first.width, _first.height) * (double)_count / (double)_total);
+	printf("encode %.1f MB/s, decode %.1f MB/s%s\n",
+		_encode > 0 ? (double)_raw / PACK_MB / _encode : 0, _decode > 0 ? (double)_raw / PACK_MB / _decode : 0,
+		_failed > 0 ? " mismatch" : "");
+
+	if ((_failed == 0) && (_path != NULL) && !PackArchive(&_mazes, _source, &_first, _count, _path))
+		_failed += 1;
+
+	_source->types = _dummy;
+	GridRemove(_source);
+	GridRemove(_grid);
+	free(_dummy);
+	free(_sizes);
+	free(_packed);
+	free(_mazes.starts);
+	free(_mazes.bonuses);
+	free(_mazes.types);
+	return _failed > 0;
+}
@@ -0,0 +1,228 @@
+/**********************************************************************************************
+*
+*   mixer - voices mixed into a single stream of samples
+*
+*   LICENSE: zlib/libpng
+*
+*   Copyright (c) 2020 Jose Miguel Rodriguez Chavarri (https://github.com/txesmi/)
+*
+**********************************************************************************************/
+
+#include "mixer.h"
+#include "thread.h"
+#include <string.h>
+
+#define max(a, b) ((a) > (b) ? (a) : (b))
+#define min(a, b) ((a) < (b) ? (a) : (b))
+
+#define MIXER_GAIN_MAX            (2 * MIXER_GAIN_ONE - 1) // a sample times the gain fits an int
+
+//--------------------------------------------------------------------------------------------
+// MIXER
+//--------------------------------------------------------------------------------------------
+
+int MixerDuration(float _seconds, int _sampleRate, float *_carry)
+{
+	float _exact = _seconds * (float)_sampleRate + *_carry;
+	int _samples = max((int)(_exact + 0.5f), 0);
+	*_carry = _exact - (float)_samples;
+	return _samples;
+}
+
+void MixerInit(MIXER *_mixer)
+{
+	memset(_mixer, 0, sizeof(MIXER));
+	for (int _i = 0; _i < MIXER_VOICES; _i += 1)
+	{
+		_mixer->voices[_i].gain = MIXER_GAIN_ONE;
+		_mixer->voices[_i].parent = -1;
+	}
+}
+
+void MixerSet(MIXER *_mixer, int _voice, const MIXERNOTE *_notes, int _count, bool _loop)
+{
+	MIXERVOICE *_v = _mixer->voices + _voice;
+	_v->notes = _notes;
+	_v->count = (_notes != NULL) ? _count : 0;
+	_v->loop = _loop;
+	_v->playing = false;
+	_v->length = 0;
+	for (int _i = 0; _i < _v->count; _i += 1)
+		_v->length += _notes[_i].duration;
+}
+
+void MixerGain(MIXER *_mixer, int _voice, float _gain)
+{
+	_mixer->voices[_voice].gain = (int)min(max(_gain * (float)MIXER_GAIN_ONE + 0.5f, 0.0f), (float)MIXER_GAIN_MAX);
+}
+
+void MixerFollow(MIXER *_mixer, int _voice, int _parent)
+{
+	// a voice can not end up following itself
+	for (int _p = _parent; _p >= 0; _p = _mixer->voices[_p].parent)
+	{
+		if (_p == _voice)
+			return;
+	}
+	_mixer->voices[_voice].parent = _parent;
+}
+
+static void MixerRestart(MIXER *_mixer, int _voice)
+{
+	MIXERVOICE *_v = _mixer->voices + _voice;
+	_v->note = 0;
+	_v->position = 0;
+	_v->time = 0;
+	_v->playing = (_v->length > 0);
+	for (int _i = 0; _i < MIXER_VOICES; _i += 1)
+	{
+		if (_mixer->voices[_i].parent == _voice)
+			MixerRestart(_mixer, _i);
+	}
+}
+
+void MixerPlay(MIXER *_mixer, int _voice)
+{
+	MixerRestart(_mixer, _voice);
+}
+
+void MixerStop(MIXER *_mixer, int _voice)
+{
+	_mixer->voices[_voice].playing = false;
+}
+
+bool MixerPlaying(const MIXER *_mixer, int _voice)
+{
+	return _mixer->voices[_voice].playing;
+}
+
+static bool MixerLeads(const MIXER *_mixer, int _voice)
+{
+	for (int _i = 0; _i < MIXER_VOICES; _i += 1)
+	{
+		if (_mixer->voices[_i].parent == _voice)
+			return true;
+	}
+	return false;
+}
+
+// adds _count samples of the voice, the waves cut at the end of their notes
+static void MixerVoice(MIXERVOICE *_v, int *_mix, int _count)
+{
+	int _done = 0;
+	while (_v->playing && (_done < _count))
+	{
+		const MIXERNOTE *_note = _v->notes + _v->note;
+		int _span = min(_count - _done, _note->duration - _v->position);
+		int _wave = min(_span, _note->samples - _v->position);
+		const short *_source = _note->wave + _v->position;
+		for (int _i = 0; _i < _wave; _i += 1)
+			_mix[_done + _i] += (_source[_i] * _v->gain) >> 15;
+		_done += _span;
+		_v->position += _span;
+		_v->time += _span;
+		if (_v->position < _note->duration)
+			continue;
+		_v->position = 0;
+		_v->note += 1;
+		if (_v->note < _v->count)
+			continue;
+		_v->note = 0;
+		_v->time = 0;
+		_v->playing = _v->loop;
+	}
+}
+
+void MixerRender(MIXER *_mixer, short *_samples, int _count)
+{
+	int _mix[MIXER_SPAN];
+	while (_count > 0)
+	{
+		// spans end where a voice with followers starts over, so they start over on that sample
+		int _span = min(_count, MIXER_SPAN);
+		bool _leads[MIXER_VOICES];
+		for (int _i = 0; _i < MIXER_VOICES; _i += 1)
+		{
+			const MIXERVOICE *_v = _mixer->voices + _i;
+			_leads[_i] = _v->playing && _v->loop && MixerLeads(_mixer, _i);
+			if (_leads[_i])
+				_span = min(_span, _v->length - _v->time);
+		}
+
+		memset(_mix, 0, (size_t)_span * sizeof(int));
+		for (int _i = 0; _i < MIXER_VOICES; _i += 1)
+			MixerVoice(_mixer->voices + _i, _mix, _span);
+		for (int _i = 0; _i < _span; _i += 1)
+			_samples[_i] = (short)min(max(_mix[_i], -32768), 32767);
+
+		for (int _i = 0; _i < MIXER_VOICES; _i += 1)
+		{
+			if (_leads[_i] && (_mixer->voices[_i].time == 0))
+				MixerRestart(_mixer, _i);
+		}
+		_mixer->clock += _span;
+		_samples += _span;
+		_count -= _span;
+	}
+}
+
+//--------------------------------------------------------------------------------------------
+// QUEUE
+//--------------------------------------------------------------------------------------------
+
+void MixerQueueInit(MIXERQUEUE *_queue)
+{
+	memset(_queue, 0, sizeof(MIXERQUEUE));
+}
+
+bool MixerPush(MIXERQUEUE *_queue, int _command, int _voice)
+{
+	unsigned int _head = (unsigned int)_queue->head; // only written here
+	if (_head - (unsigned int)AtomicLoad(&_queue->tail) >= MIXER_COMMANDS)
+		return false;
+	MIXERCOMMAND *_slot = _queue->commands + (_head & (MIXER_COMMANDS - 1));
+	_slot->command = _command;
+	_slot->voice = _voice;
+	_queue->last[_voice] = (int)(_head + 1);
+	_queue->lastCommand[_voice] = _command;
+	AtomicStore(&_queue->head, (int)(_head + 1)); // publishes the command
+	return true;
+}
+
+bool MixerQueuePlaying(const MIXER *_mixer, const MIXERQUEUE *_queue, int _voice)
+{
+	// the voices followed never change while the queue is in use
+	unsigned int _tail = (unsigned int)AtomicLoad((volatile int*)&_queue->tail);
+	for (int _v = _voice; _v >= 0; _v = _mixer->voices[_v].parent)
+	{
+		if ((int)((unsigned int)_queue->last[_v] - _tail) <= 0)
+			continue; // applied already
+		if (_queue->lastCommand[_v] == MIXER_PLAY)
+			return true;
+		if (_v == _voice)
+			return false; // stopped
+	}
+	return (AtomicLoad((volatile int*)&_queue->playing) & (1 << _voice)) != 0;
+}
+
+void MixerApply(MIXER *_mixer, MIXERQUEUE *_queue)
+{
+	unsigned int _tail = (unsigned int)_queue->tail; // only written here
+	unsigned int _head = (unsigned int)AtomicLoad(&_queue->head);
+	for (; _tail != _head; _tail += 1)
+	{
+		const MIXERCOMMAND *_slot = _queue->commands + (_tail & (MIXER_COMMANDS - 1));
+		if (_slot->command == MIXER_PLAY)
+			MixerPlay(_mixer, _slot->voice);
+		else
+			MixerStop(_mixer, _slot->voice);
+	}
+	int _playing = 0;
+	for (int _i = 0; _i < MIXER_VOICES; _i += 1)
+	{
+		if (_mixer->voices[_i].playing)
+			_playing |= 1 << _i;
+	}
+	AtomicStore(&_queue->playing, _playing); // before the commands show up as applied
+	AtomicStore(&_queue->tail, (int)_tail);
+}
@@ -0,0 +1,106 @@
+/**********************************************************************************************
+*
+*   mixer - voices mixed into a single stream of samples
+*
+*   Every voice plays a sequence of notes, each one a wave cut or padded with silence to the
+*   samples until the next note. All the voices advance on the samples rendered, the single
+*   clock of the mixer, so parts started together stay together. A voice can follow another
+*   one: it starts over on the very sample its parent starts over, looping or played again,
+*   and the parts of a song can not drift apart.
+*
+*   Samples are signed 16 bits, mono, each voice scaled by its gain and the sum clamped.
+*   A mixer is not thread safe, the thread rendering it is the one controlling it. Another
+*   thread plays and stops voices through a queue of commands: a ring with a single writer
+*   and a single reader, their positions published with atomics, so neither side ever waits
+*   for the other. The renderer applies the commands before the samples it renders next and
+*   publishes which voices play, and the writer adds the commands still queued to that.
+*
+*   LICENSE: zlib/libpng
+*
+*   Copyright (c) 2020 Jose Miguel Rodriguez Chavarri (https://github.com/txesmi/)
+*
+**********************************************************************************************/
+
+#ifndef MIXER_H
+#define MIXER_H
+
+#include <stdbool.h>
+
+//--------------------------------------------------------------------------------------------
+// DEFINES
+//--------------------------------------------------------------------------------------------
+
+#define MIXER_VOICES              8
+#define MIXER_SPAN                256 // samples mixed at once
+#define MIXER_GAIN_ONE            (1 << 15)
+#define MIXER_COMMANDS            64 // queued at most, a power of two
+
+enum MixerCommands
+{
+	MIXER_PLAY,
+	MIXER_STOP
+};
+
+//--------------------------------------------------------------------------------------------
+// MIXER
+//--------------------------------------------------------------------------------------------
+
+typedef struct
+{
+	const short *wave;
+	int samples;
+	int duration; // samples until the next note
+} MIXERNOTE;
+
+typedef struct
+{
+	const MIXERNOTE *notes; // NULL for an unused voice
+	int count;
+	int length; // samples of the whole sequence
+	bool loop;
+	bool playing;
+	int note; // current one
+	int position; // samples into the current note
+	int time; // samples into the sequence
+	int gain; // MIXER_GAIN_ONE for 1
+	int parent; // voice it follows, -1 for none
+} MIXERVOICE;
+
+typedef struct
+{
+	MIXERVOICE voices[MIXER_VOICES];
+	long long clock; // samples rendered
+} MIXER;
+
+typedef struct
+{
+	int command;
+	int voice;
+} MIXERCOMMAND;
+
+typedef struct
+{
+	MIXERCOMMAND commands[MIXER_COMMANDS];
+	volatile int head; // commands pushed, written by the writer
+	volatile int tail; // commands applied, written by the renderer
+	volatile int playing; // a bit per voice playing, written by the renderer
+	int last[MIXER_VOICES]; // writer side, head after the last command of each voice
+	int lastCommand[MIXER_VOICES];
+} MIXERQUEUE;
+
+int MixerDuration(float _seconds, int _sampleRate, float *_carry); // samples of a note, _carry keeps the rounding error across notes
+void MixerInit(MIXER *_mixer);
+void MixerSet(MIXER *_mixer, int _voice, const MIXERNOTE *_notes, int _count, bool _loop); // stops the voice
+void MixerGain(MIXER *_mixer, int _voice, float _gain);
+void MixerFollow(MIXER *_mixer, int _voice, int _parent); // -1 to follow nobody
+void MixerPlay(MIXER *_mixer, int _voice); // from the start on the next sample rendered, along with its followers
+void MixerStop(MIXER *_mixer, int _voice);
+bool MixerPlaying(const MIXER *_mixer, int _voice);
+void MixerRender(MIXER *_mixer, short *_samples, int _count);
+
+void MixerQueueInit(MIXERQUEUE *_queue);
+bool MixerPush(MIXERQUEUE *_queue, int _command, int _voice); // writer, false when the queue is full
+bool MixerQueuePlaying(const MIXER *_mixer, const MIXERQUEUE *_queue, int _voice); // writer, the queued commands of the voice and of those it follows included
+void MixerApply(MIXER *_mixer, MIXERQUEUE *_queue); // renderer, applies the queued commands and publishes the voices playing
+
+#endif // MIXER_H
@@ -38,9 +38,23 @@
 *
 **********************************************************************************************/
 
+#ifdef MAZE_HEADLESS
+#include "headless.h" // raylib subset rendering into memory
+#else
 #include "raylib.h"
 #include "raymath.h"
+#endif
+#include "maze.h"
+#include "mixer.h"
+#include "pvs.h"
+#include "world.h"
+#include "frame.h"
+#include "profile.h"
+#include "soundtrack.h"
+#include "synth.h"
+#include "thread.h"
 #include <string.h>
+#include <time.h>
 
 #define max(a, b) ((a) > (b) ? (a) : (b))
 #define min(a, b) ((a) < (b) ? (a) : (b))
@@ -55,70 +69,11 @@ const int gameScreenHeight = 32;
 
 /********************************************************************************************/
 
-//--------------------------------------------------------------------------------------------
-// DEFINES
-//--------------------------------------------------------------------------------------------
-
-#define MAZE_VISIBILITY_MAX       30 // depth max into visibility flood
-#define MAZE_ROOM_PERCENT         80 // percent of room creation tries
-#define MAZE_NEAR_PERCENT         30 // percent of conections of near depth
-#define MAZE_CUT_PERCENT          10 // percent of forced dead ends
-#define MAZE_ROOM_BONUS_PERCENT   15 // percent of room tiles filled with bonuses
-#define MAZE_DEAD_BONUS_PERCENT   60 // percent of dead end tiles filled with bonuses
-
-//--------------------------------------------------------------------------------------------
-// MACROS
-//--------------------------------------------------------------------------------------------
-
-#define GETCELL(grid, x, y)  ((grid)->cells + (x) + (y) * (grid)->width)
-#define MAKEODD(x) ((int)(x) | 1)
-#define SIGN(x) ((x) < 1 ? -1 : 1)
-
 //--------------------------------------------------------------------------------------------
 // GRID
 //--------------------------------------------------------------------------------------------
 
-typedef struct
-{
-	void *grid;
-	int index;
-	int posX;
-	int posY;
-	int type;
-	int neighborCount;
-	float depth;
-	float timeStamp;
-} CELL;
-
-typedef struct
-{
-	int width;
-	int height;
-	CELL *cells;
-	CELL *cellLast;
-	int size;
-	int bonus;
-	int ptrOffsets4[4];
-	int ptrOffsets8[8];
-} GRID;
-
-enum CellTypes
-{
-	CT_UNVISITED = 0,
-	CT_WALL,
-	CT_START,
-	CT_END_TEMP,
-	CT_END,
-	CT_ROOM_CENTER,
-	CT_ROOM_BORDER,
-	CT_DOOR,
-	CT_BONUS,
-	CT_MARK,
-	CT_LAST_COLOR,
-	CT_OPEN
-};
-
-Color CellColors[] =
+const FRAMECOLOR CellColors[FRAME_COLORS] =
 {
 	{ 255, 0,   0,   255 },
 	{ 110, 110, 110, 255 }, // CT_WALL
@@ -133,1030 +88,383 @@ Color CellColors[] =
 	{ 10,  10,  10,  255 }, // CT_OPEN -> corridors
 };
 
-enum GridDirections {
-	GRID_RIGHT,
-	GRID_UP,
-	GRID_LEFT,
-	GRID_DOWN
-};
+#define HUD_BAR_EMPTY             (FRAMECOLOR) { 60, 60, 0, 255 }
+#define HUD_BAR_BLINK             (FRAMECOLOR) { 230, 41, 55, 255 } // RED
+#define PLAYER_COLOR              (FRAMECOLOR) { 255, 255, 255, 255 } // WHITE
 
-const int offsets4[4][2] = {
-	 1,  0,
-	 0, -1,
-	-1,  0,
-	 0,  1
-};
+//--------------------------------------------------------------------------------------------
+// SOUND
+//--------------------------------------------------------------------------------------------
 
-const int offsets8[8][2] = {
-	 1,  0,
-	 1, -1,
-	 0, -1,
-	-1, -1,
-	-1,  0,
-	-1,  1,
-	 0,  1,
-	 1,  1
-};
+#define AUDIO_BLOCK               256 // samples of a stream update, 32 ms
+#define AUDIO_POLL                4 // milliseconds the audio thread sleeps between updates
 
-GRID *GridCreate(int _width, int _height)
+// The mixer belongs to the audio thread once the melodies are created: the game plays and
+// stops them through the command queue and never waits for it. Without the thread, in the
+// headless build or when it can not be created, the game loop updates the audio itself.
+MIXER gMixer; // every melody plays on a voice of its own
+MIXERQUEUE gMixerQueue; // commands of the game to the mixer
+AudioStream gStream; // the single stream the mixer feeds
+short gStreamBlock[AUDIO_BLOCK];
+THREAD *gAudioThread = NULL;
+volatile int gAudioQuit = 0;
+
+// renders the voices into the stream as it runs out of samples
+void AudioUpdate(void)
 {
-	GRID *_grid = (GRID*)malloc(sizeof(GRID));
-	_grid->width = MAKEODD(max(_width, 7));
-	_grid->height = MAKEODD(max(_height, 7));
-	_grid->size = _grid->width * _grid->height;
-	_grid->cells = (CELL*)malloc(sizeof(CELL) * _grid->size);
-	_grid->cellLast = _grid->cells + _grid->size - 1;
-	_grid->bonus = 0;
-
-	// set array member pointer offsets
-	for (int _dir = 0; _dir < 4; _dir += 1)
+	if (!IsAudioDeviceReady())
+		return;
+	MixerApply(&gMixer, &gMixerQueue);
+	while (IsAudioStreamProcessed(gStream))
 	{
-		_grid->ptrOffsets4[_dir] = offsets4[_dir][0] + offsets4[_dir][1] * _grid->width;
-		_grid->ptrOffsets8[_dir] = offsets8[_dir][0] + offsets8[_dir][1] * _grid->width;
+		MixerRender(&gMixer, gStreamBlock, AUDIO_BLOCK);
+		UpdateAudioStream(gStream, gStreamBlock, AUDIO_BLOCK);
+		MixerApply(&gMixer, &gMixerQueue); // publishes the melodies ended
 	}
-	for (int _dir = 4; _dir < 8; _dir += 1)
-		_grid->ptrOffsets8[_dir] = offsets8[_dir][0] + offsets8[_dir][1] * _grid->width;
+}
 
-	// set cell default values
-	for (int _index = 0; _index < _grid->size; _index += 1)
+void AudioWorker(void *_data)
+{
+	(void)_data;
+	while (!AtomicLoad(&gAudioQuit))
 	{
-		CELL *_cell = _grid->cells + _index;
-		_cell->grid = (void*)_grid;
-		_cell->index = _index;
-		_cell->posX = _index % _grid->width;
-		_cell->posY = _index / _grid->width;
-		_cell->type = CT_UNVISITED;
-		_cell->depth = 0;
-		_cell->timeStamp = 0;
+		AudioUpdate();
+		ThreadSleep(AUDIO_POLL);
 	}
-
-	return _grid;
 }
 
-void GridRemove(GRID *_grid)
-{
-	free(_grid->cells);
-	free(_grid);
-}
+//--------------------------------------------------------------------------------------------
+// MELODY
+//--------------------------------------------------------------------------------------------
 
-void GridMazeRoom(GRID *_grid, CELL *_cell, int _cellsToEnd, int _count)
+// from the start, along with the melodies following it, on the next block of the stream
+void MelodyPlay(MELODY *_melody)
 {
-	if (_cell->type == CT_END) // avoid ending cells
-		return;
-	if (_cell->type == CT_END_TEMP)
-		return;
-
-	// look for unvisited neighbors
-	for (
-		struct { int attempt; int dir; int turn; } _s = { 
-			0, 
-			GetRandomValue(0, 3), // random direction and turn
-			1 + GetRandomValue(0, 1) * 2 
-		};
-		_s.attempt < 4;
-		_s.attempt += 1, _s.dir = (_s.dir + _s.turn) % 4
-	) {
-		// check the other three corners of the room
-		CELL *_cellN1 = _cell + _grid->ptrOffsets4[_s.dir] * 2;
-		if (_cellN1 < _grid->cells) 
-			continue;
-		if (_cellN1 > _grid->cellLast)
-			continue;
-		if (_cellN1->type > CT_UNVISITED) 
-			continue;
-
-		int _dir2 = (_s.dir + _s.turn) % 4;
-		CELL *_cellN2 = _cell + _grid->ptrOffsets4[_dir2] * 2;
-		if (_cellN2 < _grid->cells)
-			continue;
-		if (_cellN2 > _grid->cellLast)
-			continue;
-		if (_cellN2->type > CT_UNVISITED)
-			continue;
-
-		CELL *_cellN3 = _cell + (_grid->ptrOffsets4[_s.dir] + _grid->ptrOffsets4[_dir2]) * 2;
-		if (_cellN3 < _grid->cells)
-			continue;
-		if (_cellN3 > _grid->cellLast)
-			continue;
-		if (_cellN3->type > CT_UNVISITED)
-			continue;
-
-		// set the nine cells as walkable
-		for (
-			struct { int y; int yL; int stepY; int xL; int stepX; } _sT =
-			{
-				_cell->posY,
-				_cell->posY + (offsets4[_s.dir][1] + offsets4[_dir2][1]) * 3,
-				SIGN(_cellN3->posY - _cell->posY),
-				_cell->posX + (offsets4[_s.dir][0] + offsets4[_dir2][0]) * 3,
-				SIGN(_cellN3->posX - _cell->posX)
-			};
-			_sT.y != _sT.yL; 
-			_sT.y += _sT.stepY
-		) {
-			for (int _x = _cell->posX; _x != _sT.xL; _x += _sT.stepX)
-			{
-				CELL *_cellT = GETCELL(_grid, _x, _sT.y);
-				if (_cellT->type > CT_START)
-					continue;
-
-				_cellT->type = _cellsToEnd;
-			}
-		}
-		if (0 < _count) // last room?
-		{
-			_cellsToEnd += 4;
-			int _room = GetRandomValue(0, 2);
-			switch (_room) {
-			case 0: GridMazeRoom(_grid, _cellN1, _cellsToEnd, _count - 1); break;
-			case 1: GridMazeRoom(_grid, _cellN2, _cellsToEnd, _count - 1); break;
-			case 2: GridMazeRoom(_grid, _cellN3, _cellsToEnd, _count - 1); break;
-			}
-		}
-		break;
-	}
+	if (_melody != NULL)
+		MixerPush(&gMixerQueue, MIXER_PLAY, _melody->voice); // dropped when the queue is full
 }
 
-CELL *GridMaze(GRID *_grid) {
-	// prepare the grid for maze
-	// it states walkable cells as CT_UNVISITED (0)
-	// walls pattern
-	// X X X X X X X 
-	// X 0 X 0 X 0 X
-	// X X X X X X X
-	// X 0 X 0 X 0 X
-	// X X X X X X X
-	for ( // pair rows
-		struct { CELL *c; CELL *cL; int step; } _sY =
-		{
-			_grid->cells,
-			_grid->cells + _grid->size,
-			_grid->width * 2
-		};
-		_sY.c < _sY.cL;
-		_sY.c += _grid->width * 2
-		) {
-		for (
-			struct { CELL *c; CELL *cL; } _sX =
-			{
-				_sX.c = _sY.c,
-				_sX.cL = _sX.c + _grid->width
-			};
-			_sX.c < _sX.cL;
-			_sX.c += 1
-			) {
-			_sX.c->type = CT_WALL;
-			_sX.c->depth = 0;
-		}
-	}
-
-	for ( // odd rows
-		struct { CELL *c; CELL *cL; int step; } _sY =
-		{
-			_grid->cells + _grid->width,
-			_grid->cells + _grid->size,
-			_grid->width * 2
-		};
-		_sY.c < _sY.cL;
-		_sY.c += _sY.step
-		) {
-		for (
-			struct { CELL *c; CELL *cL; int t; } _sX =
-			{
-				_sX.c = _sY.c,
-				_sX.cL = _sX.c + _grid->width,
-				CT_WALL
-			};
-			_sX.c < _sX.cL;
-			_sX.c += 1, _sX.t ^= CT_WALL
-			) {
-			_sX.c->type = _sX.t;
-			_sX.c->depth = 0;
-		}
-	}
-
-	_grid->bonus = 0;
-
-	// break the outter square shape of the grid by disabling some cells beside the border
-	for (int _x = 1; _x < _grid->width; _x += _grid->width - 3) { // two loops, left and right columns
-		for (int _y = 1; _y < _grid->height; _y += 2) { // odd indexed cells
-			if (GetRandomValue(0, 1) > 0)
-				continue;
-			_grid->cells[_x + _y * _grid->width].type = CT_WALL;
-		}
-	}
-	for (int _y = 1; _y < _grid->height; _y += _grid->height - 3) { // two loops, up and down rows
-		for (int _x = 1; _x < _grid->width; _x += 2) { // odd indexed cells
-			if (GetRandomValue(0, 1) > 0)
-				continue;
-			_grid->cells[_x + _y * _grid->width].type = CT_WALL;
-		}
-	}
-
-	// random ending cell
-	// odd coordinates
-	CELL *_cellEnd = GETCELL(_grid, MAKEODD(GetRandomValue(3, _grid->width - 4)), MAKEODD(GetRandomValue(3, _grid->height - 4)));
-	_cellEnd->type = CT_END;
-	int _cellsToEnd = CT_OPEN;
-	CELL *_cell = _cellEnd;
-
-	while (1)
-	{
-		// get random direction and turn direction
-		int _dir = GetRandomValue(0, 3);
-		int _turnSide = 1 + GetRandomValue(0, 1) * 2;
-
-		// look for unvisited neighbor cell
-		int _attempts = 0;
-		for (; _attempts < 4; _attempts += 1, _dir = (_dir + _turnSide) % 4)
-		{
-			// random sudden cuts results in more dead ends
-			if (GetRandomValue(1, 100) <= MAZE_CUT_PERCENT) {
-				_attempts = 4;
-				break;
-			}
-
-			// check grid bounds
-			int _nextX = _cell->posX + offsets4[_dir][0] * 2;
-			if (_nextX < 0) continue;
-			if (_nextX >= _grid->width) continue;
-
-			int _nextY = _cell->posY + offsets4[_dir][1] * 2;
-			if (_nextY < 0) continue;
-			if (_nextY >= _grid->height) continue;
-
-			// get nextcell
-			CELL *_cellN = _cell + _grid->ptrOffsets4[_dir] * 2;
-
-			// skip already visited cells
-			if (_cellN->type > CT_UNVISITED) continue;
-
-			// set next cell as walkable
-			_cellN->type = CT_OPEN;
-
-			// set also the cell in the middle
-			(_cell + _grid->ptrOffsets4[_dir])->type = CT_OPEN;
-
-			// save the stepped position
-			_cell = _cellN;
-
-			// increase the depth
-			_cellsToEnd += 2;
-
-			// random rooms
-			if (GetRandomValue(1, 100) <= MAZE_ROOM_PERCENT)
-				GridMazeRoom(_grid, _cell, _cellsToEnd, 1);
-			
-			break;
-		}
-
-		if (_attempts == 4) // if it could not find a walkable neighbor
-		{
-			if ((_cell->type != CT_END) && (_cell->type != CT_END_TEMP))  // not an end yet
-			{
-				// go back to an open cell
-				_cell->type = _cellsToEnd;
-				_cellsToEnd -= 1;
-				int _dir2 = 0;
-				for (; _dir2 < 4; _dir2 += 1)
-				{
-					CELL *_cellN = _cell + _grid->ptrOffsets4[_dir2];
-					if (_cellN->type != CT_OPEN)
-						continue;
-					_cellN->type = _cellsToEnd;
-					_cellsToEnd -= 1;
-					_cell = _cellN + _grid->ptrOffsets4[_dir2];
-					break;
-				}
-#ifdef _DEBUG
-				if (_dir2 == 4)
-					vprintf(FormatText("UNKNOWN ERROR: Open cell not found\n       Current depth:%i\n       Cell type: %i", _cellsToEnd, _cell->type));
-#endif
-			}
-			else // end reached
-			{
-				// set temporary ending cells as a common walkable cell
-				if (_cell->type == CT_END_TEMP)
-					_cell->type = _cellsToEnd;
-
-				// Look for unvisited cells
-				int _y = 1;
-				for (; _y < _grid->height; _y += 2)
-				{
-					int _x = 1;
-					for (; _x < _grid->width; _x += 2)
-					{
-						CELL *_cellT = GETCELL(_grid, _x, _y);
-						if (_cellT->type != CT_UNVISITED) // avoid already visited cells
-							continue;
-						CELL *_cellN = NULL;
-						// check visited neighbors
-						int _dir2 = 0;
-						for (; _dir2 < 4; _dir2 += 1)
-						{
-							int _nextX = _cellT->posX + offsets4[_dir2][0] * 2;
-							int _nextY = _cellT->posY + offsets4[_dir2][1] * 2;
-							if (_nextX < 0) continue;
-							if (_nextX >= _grid->width) continue;
-							if (_nextY < 0) continue;
-							if (_nextY >= _grid->height) continue;
-							_cellN = GETCELL(_grid, _nextX, _nextY);
-							if (_cellN->type > CT_OPEN)
-								break;
-						}
-						if (_dir2 != 4)  // walkable neighbor found
-						{
-							// set the cell in the middle as walkable
-							CELL *_cellN2 = _cellT + _grid->ptrOffsets4[_dir2];
-							_cellN2->type = _cellN->type + 1; // one step further of found neighbor depth
-
-							// start a new path
-							_cell = _cellT;
-							_cell->type = CT_END_TEMP; // set as a temporary end cell
-							_cellsToEnd = _cellN2->type + 1; // one step further for next cells
-							break;
-						}
-					}
-					if (_x < _grid->width)
-						break;
-				}
-				if (_y >= _grid->height)
-					break;
-			}
-		}
-	}
-
-	// Connect depth near
-	for (int _y = 3; _y < _grid->height - 3; _y += 2)
-	{
-		for (int _x = 3; _x < _grid->width - 3; _x += 2)
-		{
-			_cell = GETCELL(_grid, _x, _y);
-			if (_cell->type < CT_OPEN) // avoid special cells
-				continue;
-			for (int _dir = 0; _dir < 4; _dir += 1)
-			{
-				CELL *_cellN = _cell + _grid->ptrOffsets4[_dir] * 2;
-				if (_cellN->type < CT_OPEN)
-					continue;
-				if (GetRandomValue(1, 100) <= MAZE_NEAR_PERCENT)
-					continue;
-				if (abs(_cellN->type - _cell->type) < 3)
-					(_cell + _grid->ptrOffsets4[_dir])->type = (_cell->type + _cellN->type / 2);
-			}
-		}
-	}
-
-	// Remove isolated wall cells
-	for (int _y = 2; _y < _grid->height - 2; _y += 1)
-	{
-		for (int _x = 2; _x < _grid->width - 2; _x += 1)
-		{
-			_cell = GETCELL(_grid, _x, _y);
-			if (_cell->type != CT_WALL)
-				continue;
-			int _cellsToEnd = 0;
-			int _dir = 0;
-			for (; _dir < 8; _dir += 1)
-			{
-				CELL *_cellN = _cell + _grid->ptrOffsets8[_dir];
-				if (_cellN->type < CT_START)
-					break;
-				if ((_cellN->type >= CT_START) && (_cellN->type <= CT_END)) // start and end are navigable cells that has no depth value as ID
-					if (_cellsToEnd < CT_OPEN)
-						_cellsToEnd = CT_OPEN;
-					else
-						_cellsToEnd += _cellsToEnd / (_dir + 1); // add the average of already found neighbors
-				else
-					_cellsToEnd += _cellN->type;
-			}
-			if (_dir == 8) // if it is surrounded
-				_cell->type = _cellsToEnd / 8; // set the depth average of all its neighborhood
-		}
-	}
-
-	// Look for start point
-	CELL *_cellStart = _grid->cells;
-	for (int _i = 1; _i < _grid->width / 2; _i += 2) // look on outter cells first, odd indexed cells 
-	{
-		for (int _x = _i; _x < _grid->width; _x += _grid->width - (_i + 2)) { // two loops, left and right columns
-			for (int _y = _i; _y < _grid->height; _y += 2) { // odd indexed cells
-				_cell = GETCELL(_grid, _x, _y);
-				if (_cell->type > _cellStart->type)
-					_cellStart = _cell;
-			}
-		}
-		for (int _y = _i; _y < _grid->height; _y += _grid->height - (_i + 2)) { // two loops, up and down rows
-			for (int _x = _i; _x < _grid->width; _x += 2) { // odd indexed cells
-				_cell = GETCELL(_grid, _x, _y);
-				if (_cell->type > _cellStart->type)
-					_cellStart = _cell;
-			}
-		}
-		if (_cellStart != NULL) break; // early break that ensures the starting cell is in the border of the maze
-	}
-	_cellStart->type = CT_START;
-
-	// count neighbors and identify room centers
-	for (int _y = 1; _y < _grid->height - 1; _y += 1) {
-		for (int _x = 1; _x < _grid->width - 1; _x += 1) {
-			_cell = GETCELL(_grid, _x, _y);
-			_cell->neighborCount = 0;
-			if (_cell->type < CT_START)
-				continue;
-			for (int _dir = 0; _dir < 8; _dir += 1) {
-				CELL *_cellN = _cell + _grid->ptrOffsets8[_dir];
-				if (_cellN->type < CT_START)
-					continue;
-				_cell->neighborCount += 1;
-			}
-			if (_cell->neighborCount == 8)
-				_cell->type = CT_ROOM_CENTER;
-		}
-	}
-
-	// identify room borders
-	for (int _y = 1; _y < _grid->height - 1; _y += 1) {
-		for (int _x = 1; _x < _grid->width - 1; _x += 1) {
-			_cell = GETCELL(_grid, _x, _y);
-			if (_cell->type < CT_OPEN) // avoid any special cell
-				continue;
-			for (int _dir = 0; _dir < 8; _dir += 1) {
-				CELL *_cellN = _cell + _grid->ptrOffsets8[_dir];
-				if (_cellN->type != CT_ROOM_CENTER)
-					continue;
-				_cell->type = CT_ROOM_BORDER;
-				break;
-			}
-		}
-	}
-
-	// doors around rooms
-	for (int _y = 1; _y < _grid->height - 1; _y += 1) {
-		for (int _x = 1; _x < _grid->width - 1; _x += 1) {
-			_cell = GETCELL(_grid, _x, _y);
-			if (_cell->type < CT_OPEN) // avoid any special cell
-				continue;
-			for (int _dir = 0; _dir < 4; _dir += 1) {
-				CELL *_cellN = _cell + _grid->ptrOffsets4[_dir];
-				if (_cellN->type != CT_ROOM_BORDER)
-					continue;
-				_cell->type = CT_DOOR;
-				break;
-			}
-		}
-	}
-
-	// doors on corridor crosses
-	for (int _y = 1; _y < _grid->height - 1; _y += 1) {
-		for (int _x = 1; _x < _grid->width - 1; _x += 1) {
-			_cell = GETCELL(_grid, _x, _y);
-			if (_cell->type < CT_OPEN) // avoid any special cell
-				continue;
-			int _count = 0;
-			CELL *_cellCheapest = _cell;
-			int _dir = 0;
-			for (; _dir < 4; _dir += 1) {
-				CELL *_cellN = _cell + _grid->ptrOffsets4[_dir];
-				if (_cellN->type < CT_OPEN)
-					continue;
-				_count += 1;
-				if (_cellN->type >= _cellCheapest->type)
-					continue;
-				_cellCheapest = _cellN;
-			}
-			if (_cell != _cellCheapest)
-				if (_count > 2)
-					_cellCheapest->type = CT_DOOR;
-		}
-	}
-
-	// corridor treasures
-	for (int _y = 1; _y < _grid->height - 1; _y += 2) {
-		for (int _x = 1; _x < _grid->width - 1; _x += 2) {
-			_cell = GETCELL(_grid, _x, _y);
-			if (_cell->type < CT_OPEN) // avoid special cells
-				continue;
-			if (_cell->neighborCount != 1)
-				continue;
-			if (GetRandomValue(0, 100) > MAZE_DEAD_BONUS_PERCENT)
-				continue;
-			_cell->type = CT_BONUS;
-			_grid->bonus += 1;
-		}
-	}
-
-	// room treasures
-	for (int _x = 1; _x < _grid->width - 1; _x += 1) {
-		for (int _y = 1; _y < _grid->height - 1; _y += 1) {
-			_cell = GETCELL(_grid, _x, _y);
-			if (_cell->type < CT_ROOM_CENTER) // avoid special cells
-				continue;
-			if (_cell->type > CT_ROOM_BORDER) // avoid corridor cells
-				continue;
-			if (GetRandomValue(0, 100) > MAZE_ROOM_BONUS_PERCENT)
-				continue;
-			_cell->type = CT_BONUS;
-			_grid->bonus += 1;
-		}
-	}
-
-	if (_grid->bonus == 0)
-		return GridMaze(_grid);
-
-	return _cellStart;
+void MelodyStop(MELODY *_melody)
+{
+	if (_melody != NULL)
+		MixerPush(&gMixerQueue, MIXER_STOP, _melody->voice);
 }
 
-void GridFloodVisibility(CELL *_cell, float _depth, float _timeStamp)
+// as the game asked for it, even before the audio thread gets to it
+bool IsMelodyPlaying(MELODY *_melody)
 {
-	_cell->timeStamp = _timeStamp;
-
-	// end by depth
-	if (_depth < 0) {
-		_cell->depth = 0;
-		if(_depth < -4)
-			return;
-	}
-	else
-	{
-		// set depth
-		_cell->depth = _depth;
-	}
-	_depth -= 5 - _cell->neighborCount / 2;
-
-	// end by visibility blocking cells
-	if ((_cell->type <= CT_WALL) || (_cell->type == CT_DOOR))
-		return;
-
-	// flood heighborhood
-	for (int _dir = 0; _dir < 8; _dir += 1)
-	{
-		CELL *_cellT = _cell + ((GRID*)_cell->grid)->ptrOffsets8[_dir];
-		if ((_cellT->timeStamp != _timeStamp) || (_cellT->depth < _depth)) // avoid nearer already computed cells
-			GridFloodVisibility(_cellT, _depth, _timeStamp);
-	}
+	return (_melody != NULL) && MixerQueuePlaying(&gMixer, &gMixerQueue, _melody->voice);
 }
 
 //--------------------------------------------------------------------------------------------
-// SOUND
+// GAME
 //--------------------------------------------------------------------------------------------
 
-#define SND_BUF_SIZE               4096
-#define SND_SAMPLE_RATE            8000
-
-typedef struct {
-	short *wave;
-	int samples;
-	float length;
-	struct SOUND *next;
-} SOUND;
-
-SOUND *SoundCreateTone(float _frequency, float _length, float _volume) {
-	_length *= (double)SND_SAMPLE_RATE / 11025.0;
-	SOUND *_sound = (SOUND*)malloc(sizeof(SOUND));
-	int _waveLength = (int)((float)SND_SAMPLE_RATE / _frequency);
-	int _waveCount = (int)(min((float)SND_BUF_SIZE, (float)SND_BUF_SIZE * _length) / _waveLength);
-	_sound->samples = _waveLength * _waveCount;
-	_sound->wave = (short*)malloc(sizeof(short) * _sound->samples);
-	for (int _s = 0; _s < _sound->samples; _s += 1)
-	{
-		int _amplitude = min(_s * 256, 25000 / 4); // attack
-		_amplitude = _amplitude * (float)(_sound->samples - _s) / (float)_sound->samples; // decay
-		_sound->wave[_s] = (short)(sinf(((2 * PI * (float)_s / _waveLength))) * _amplitude * _volume);
-		_sound->wave[_s] += (short)(sinf(((4 * PI * (float)_s / _waveLength))) * _amplitude * _volume * 0.5f); // octave up
-		_sound->wave[_s] += (short)(sinf(((8 * PI * (float)_s / _waveLength))) * _amplitude * _volume * 0.25f); // 2 octaves up
-	}
+// melodies
+SOUNDTRACK gSoundtrack;
+MELODY *gMelodyHigh = NULL;
+MELODY *gMelodyHighEnd = NULL;
+MELODY *gMelodyBass = NULL;
+MELODY *gMelodyBassEnd = NULL;
+MELODY *gMelodyClave = NULL;
+MELODY *gMelodyClaveEnd = NULL;
+MELODY *gMelodyBonus = NULL;
+MELODY *gMelodyOpen = NULL;
 
-	_sound->length = (float)SND_BUF_SIZE * _length / (float)SND_SAMPLE_RATE;
+// grid pointers
+GENERATOR gGenerator;
+GRID *gGrid = NULL;
+PVS *gPvs = NULL; // baked visibility of gGrid, NULL when it could not be baked
+WORLD *gWorld = NULL; // endless maze, gGrid is its window
+int gCell = 0; // current cell
 
-	return _sound;
-}
+// screen of the maze, composed on the CPU and uploaded once per frame
+FRAME gFrame;
+Texture2D gFrameTexture;
 
-SOUND *SoundCreateNoise(float _length, float _volume) {
-	_length *= (double)SND_SAMPLE_RATE / 11025.0;
-	SOUND *_sound = (SOUND*)malloc(sizeof(SOUND));
-	_sound->samples = (int)min((float)SND_BUF_SIZE, (float)SND_BUF_SIZE * _length);
-	_sound->wave = (short*)malloc(sizeof(short) * _sound->samples);
-	for (int _s = 0; _s < _sound->samples; _s += 1)
-	{
-		int _amplitude = min(_s * 256, 25000); // attack
-		_amplitude = _amplitude * (float)(_sound->samples - _s) / (float)_sound->samples; // decay
-		_sound->wave[_s] = (short)(GetRandomValue(-_amplitude, _amplitude) * _volume);
-	}
-	_sound->length = (float)_sound->samples / (float)SND_SAMPLE_RATE;
-	return _sound;
-}
+#define MOVE_STEP                0.12f
+#define SELECTOR_MIN             2
+#define SELECTOR_MAX             8
+#define SELECTOR_ENDLESS         (SELECTOR_MAX + 1) // selector past the biggest size
+#define ENDLESS_BUDGET_MB        16 // chunks kept around the endless window
+int gSizeSelector = 4;
 
-SOUND *SoundCreateHit(float _length, float _volume)
+enum GameStates
 {
-	SOUND *_sound = SoundCreateNoise(0.125f, _volume);
-	_sound->length = _length;
-	return _sound;
-}
+	GAME_MAIN,
+	GAME_WIN,
+	GAME_RUN,
+	GAME_STATES_COUNT
+};
 
-void SoundRemove(SOUND *_sound)
-{
-	free(_sound->wave);
-	free(_sound);
-}
+int gState = GAME_MAIN;
+float gSpeed = 0;
+int gBonus = 0; // collected
+float gHudBlink = 0;
+bool gStartPending = false; // start pressed before the maze was ready
 
 //--------------------------------------------------------------------------------------------
-// MELODY
+// PREGEN
 //--------------------------------------------------------------------------------------------
 
-typedef struct {
-	SOUND *first;
-	SOUND *current;
-	AudioStream stream;
-	float time;
-} MELODY;
+// The next maze is generated on a worker thread while the menu or the game is shown, and
+// handed over by pointer when the player starts it. A selector change requests another
+// one, and a maze requested before is freed as soon as it is done.
 
-enum MelodyTypes
+typedef struct
 {
-	MELODY_END,
-	MELODY_TONE,
-	MELODY_NOISE,
-	MELODY_HIT
-};
-
-enum MidiKeys {
-	MIDI_A0 = 21,
-	MIDI_A0a,
-	MIDI_B0,
-	MIDI_C1 = 24,
-	MIDI_C1a,
-	MIDI_D1,
-	MIDI_D1a,
-	MIDI_E1,
-	MIDI_F1,
-	MIDI_F1a,
-	MIDI_G1,
-	MIDI_G1a,
-	MIDI_A1,
-	MIDI_A1a,
-	MIDI_B1,
-	MIDI_C2 = 36,
-	MIDI_C2a,
-	MIDI_D2,
-	MIDI_D2a,
-	MIDI_E2,
-	MIDI_F2,
-	MIDI_F2a,
-	MIDI_G2,
-	MIDI_G2a,
-	MIDI_A2,
-	MIDI_A2a,
-	MIDI_B2,
-	MIDI_C3 = 48,
-	MIDI_C3a,
-	MIDI_D3,
-	MIDI_D3a,
-	MIDI_E3,
-	MIDI_F3,
-	MIDI_F3a,
-	MIDI_G3,
-	MIDI_G3a,
-	MIDI_A3,
-	MIDI_A3a,
-	MIDI_B3,
-	MIDI_C4 = 60,
-	MIDI_C4a,
-	MIDI_D4,
-	MIDI_D4a,
-	MIDI_E4,
-	MIDI_F4,
-	MIDI_F4a,
-	MIDI_G4,
-	MIDI_G4a,
-	MIDI_A4,
-	MIDI_A4a,
-	MIDI_B4,
-	MIDI_C5 = 72,
-	MIDI_C5a,
-	MIDI_D5,
-	MIDI_D5a,
-	MIDI_E5,
-	MIDI_F5,
-	MIDI_F5a,
-	MIDI_G5,
-	MIDI_G5a,
-	MIDI_A5,
-	MIDI_A5a,
-	MIDI_B5,
-	MIDI_C6 = 84,
-	MIDI_C6a,
-	MIDI_D6,
-	MIDI_D6a,
-	MIDI_E6,
-	MIDI_F6,
-	MIDI_F6a,
-	MIDI_G6,
-	MIDI_G6a,
-	MIDI_A6,
-	MIDI_A6a,
-	MIDI_B6,
-	MIDI_C7 = 96,
-	MIDI_C7a,
-	MIDI_D7,
-	MIDI_D7a,
-	MIDI_E7,
-	MIDI_F7,
-	MIDI_F7a,
-	MIDI_G7,
-	MIDI_G7a,
-	MIDI_A7,
-	MIDI_A7a,
-	MIDI_B7,
-	MIDI_C8 = 108
-};
+	int selector;
+	MAZEID id; // fixed size mazes
+	unsigned long long seed; // endless world
+} PREGENJOB;
 
-double FrequencyFromMidi(int _midi)
+typedef struct
 {
-	return 440.0 * pow(2.0, ((double)_midi - 69.0) / 12.0);
-}
+	GRID *grid;
+	PVS *pvs;
+	WORLD *world;
+	int cell;
+} PREGENMAZE;
 
-MELODY *MelodyCreate(float *_sndDesc)
+typedef struct
 {
-	MELODY *_melody = (MELODY*)malloc(sizeof(MELODY));
-	memset(_melody, 0, sizeof(MELODY));
+	THREAD *thread; // NULL builds the mazes on the main thread when they are taken
+	MUTEX *mutex; // guards everything below
+	COND *cond; // signaled on new jobs and on quit
+	int quit;
+	int requested; // serial of the last job
+	int finished; // serial of the job the maze belongs to
+	bool failed; // the finished job ran out of memory
+	PREGENJOB job;
+	PREGENMAZE maze; // owned by the worker until taken
+} PREGEN;
 
-	_melody->stream = InitAudioStream(SND_SAMPLE_RATE, 16, 1);
-	_melody->time = 0;
+PREGEN gPregen;
 
-	switch ((int)*_sndDesc)
+// builds the maze of a job with its visibility from the starting cell, false when out of memory
+bool PregenBuild(const PREGENJOB *_job, PREGENMAZE *_maze)
+{
+	memset(_maze, 0, sizeof(PREGENMAZE));
+	if (_job->selector == SELECTOR_ENDLESS)
 	{
-	case MELODY_TONE:  _melody->first = SoundCreateTone((float)FrequencyFromMidi((int)*(_sndDesc + 1)), *(_sndDesc + 2), *(_sndDesc + 3)); break;
-	case MELODY_NOISE: _melody->first = SoundCreateNoise(*(_sndDesc + 2), *(_sndDesc + 3)); break;
-	case MELODY_HIT:   _melody->first = SoundCreateHit(*(_sndDesc + 2), *(_sndDesc + 3)); break;
+		_maze->world = WorldCreate(_job->seed, ENDLESS_BUDGET_MB);
+		if (_maze->world == NULL)
+			return false;
+		_maze->grid = _maze->world->window;
+		_maze->cell = WorldStart(_maze->world);
+		GridFloodVisibility(_maze->grid, _maze->cell, MAZE_VISIBILITY_MAX);
+		return true;
 	}
 
-	_sndDesc += 4;
-	SOUND *_sndPrev = _melody->first;
-	for (; *_sndDesc != MELODY_END; _sndDesc += 4)
-	{
-		switch ((int)*_sndDesc)
-		{
-		case MELODY_TONE:  _sndPrev->next = SoundCreateTone((float)FrequencyFromMidi((int)*(_sndDesc + 1)), *(_sndDesc + 2), *(_sndDesc + 3)); break;
-		case MELODY_NOISE: _sndPrev->next = SoundCreateNoise(*(_sndDesc + 2), *(_sndDesc + 3)); break;
-		case MELODY_HIT:   _sndPrev->next = SoundCreateHit(*(_sndDesc + 2), *(_sndDesc + 3)); break;
-		}
-		_sndPrev = _sndPrev->next;
-	}
-	_sndPrev->next = NULL;
+	_maze->grid = GridFromId(&_job->id, &_maze->cell);
+	if (_maze->grid == NULL)
+		return false;
+	_maze->pvs = PvsBake(_maze->grid, MAZE_VISIBILITY_MAX, 0);
+	if ((_maze->pvs == NULL) || !PvsApply(_maze->pvs, _maze->grid, _maze->cell))
+		GridFloodVisibility(_maze->grid, _maze->cell, MAZE_VISIBILITY_MAX);
+	return true;
+}
 
-	return _melody;
+void PregenFree(PREGENMAZE *_maze)
+{
+	if (_maze->pvs != NULL)
+		PvsRemove(_maze->pvs);
+	if (_maze->world != NULL)
+		WorldRemove(_maze->world);
+	else if (_maze->grid != NULL)
+		GridRemove(_maze->grid);
+	memset(_maze, 0, sizeof(PREGENMAZE));
 }
 
-void MelodyRemove(MELODY *_melody)
+void PregenWorker(void *_data)
 {
-	CloseAudioStream(_melody->stream);
-	SOUND *_sndPrev = _melody->first;
-	while (_sndPrev->next)
+	PREGEN *_pregen = (PREGEN*)_data;
+	MutexLock(_pregen->mutex);
+	while (!_pregen->quit)
 	{
-		SOUND *_snd = _sndPrev->next;
-		SoundRemove(_sndPrev);
-		_sndPrev = _snd;
+		if (_pregen->finished == _pregen->requested)
+		{
+			CondWait(_pregen->cond, _pregen->mutex);
+			continue;
+		}
+		int _serial = _pregen->requested;
+		PREGENJOB _job = _pregen->job;
+		MutexUnlock(_pregen->mutex);
+
+		PREGENMAZE _maze;
+		bool _built = PregenBuild(&_job, &_maze);
+
+		MutexLock(_pregen->mutex);
+		if (_serial == _pregen->requested)
+		{
+			_pregen->maze = _maze;
+			_pregen->failed = !_built;
+			_pregen->finished = _serial;
+		}
+		else // requested again meanwhile
+		{
+			MutexUnlock(_pregen->mutex);
+			PregenFree(&_maze);
+			MutexLock(_pregen->mutex);
+		}
 	}
-	SoundRemove(_sndPrev);
-	free(_melody);
+	MutexUnlock(_pregen->mutex);
 }
 
-bool MelodyPlay(MELODY *_melody, float _timeStep)
+// asks for a maze of the selected size, the random draws stay on the main thread
+void GamePregenRequest(void)
 {
-	if (_melody->current == NULL)
+	PREGENJOB _job;
+	memset(&_job, 0, sizeof(PREGENJOB));
+	_job.selector = gSizeSelector;
+	if (gSizeSelector == SELECTOR_ENDLESS)
 	{
-		SOUND *_sndT = _melody->current = _melody->first;
-		if (IsAudioStreamPlaying(_melody->stream))
-			StopAudioStream(_melody->stream);
-		UpdateAudioStream(_melody->stream, _sndT->wave, _sndT->samples);
-		PlayAudioStream(_melody->stream);
-		_melody->time = 0;
+		_job.seed = ((unsigned long long)GeneratorNext(&gGenerator) << 32) | GeneratorNext(&gGenerator);
 	}
 	else
 	{
-		_melody->time += _timeStep;
-		if (_melody->time >= _melody->current->length)
-		{
-			_melody->time -= _melody->current->length;
-			SOUND *_sndT = _melody->current = _melody->current->next;
-			if (_sndT == NULL)
-			{
-				return false;
-			}
-			if (IsAudioStreamPlaying(_melody->stream))
-				StopAudioStream(_melody->stream);
-			UpdateAudioStream(_melody->stream, _sndT->wave, _sndT->samples);
-			PlayAudioStream(_melody->stream);
-		}
+		float _size = 11 + pow(2, gSizeSelector);
+		float _prop = (float)GeneratorRandom(&gGenerator, 7, 13) / 10.0f;
+		_job.id.seed = ((unsigned long long)GeneratorNext(&gGenerator) << 32) | GeneratorNext(&gGenerator);
+		_job.id.width = max(_size * _prop, 9);
+		_job.id.height = max(_size / _prop, 9);
+		_job.id.bonusMin = 1;
+	}
+
+	if (gPregen.thread != NULL)
+		MutexLock(gPregen.mutex);
+	PREGENMAZE _old = gPregen.maze; // done but never taken
+	memset(&gPregen.maze, 0, sizeof(PREGENMAZE));
+	gPregen.job = _job;
+	gPregen.requested += 1;
+	if (gPregen.thread != NULL)
+	{
+		CondBroadcast(gPregen.cond);
+		MutexUnlock(gPregen.mutex);
 	}
-	return true;
+	PregenFree(&_old);
 }
 
-void MelodyStop(MELODY *_melody)
+// hands the requested maze over and requests the next one, 1 when taken, 0 while it is
+// being generated, -1 when it ran out of memory
+int GamePregenTake(void)
 {
-	if (IsAudioStreamPlaying(_melody->stream))
-		StopAudioStream(_melody->stream);
-	_melody->current = NULL;
-}
+	if (gPregen.thread == NULL)
+	{
+		gPregen.failed = !PregenBuild(&gPregen.job, &gPregen.maze);
+		gPregen.finished = gPregen.requested;
+	}
+	else
+		MutexLock(gPregen.mutex);
 
-bool MelodyLoop(MELODY *_melody, float _timeStep)
-{
-	if (MelodyPlay(_melody, _timeStep))
-		return true;
-	MelodyPlay(_melody, _timeStep);
-	return false;
+	int _taken = 0;
+	if (gPregen.finished == gPregen.requested)
+	{
+		_taken = gPregen.failed ? -1 : 1;
+		gGrid = gPregen.maze.grid;
+		gPvs = gPregen.maze.pvs;
+		gWorld = gPregen.maze.world;
+		gCell = gPregen.maze.cell;
+		memset(&gPregen.maze, 0, sizeof(PREGENMAZE));
+	}
+
+	if (gPregen.thread != NULL)
+		MutexUnlock(gPregen.mutex);
+	if (_taken != 0)
+		GamePregenRequest();
+	return _taken;
 }
 
-bool IsMelodyPlaying(MELODY *_melody)
+void GamePregenInit(void)
 {
-	return _melody->current != NULL;
+	memset(&gPregen, 0, sizeof(PREGEN));
+	gPregen.mutex = MutexCreate();
+	gPregen.cond = CondCreate();
+#ifndef MAZE_HEADLESS // generated on the main thread, a script replays the same frames
+	if ((gPregen.mutex != NULL) && (gPregen.cond != NULL))
+		gPregen.thread = ThreadCreate(PregenWorker, &gPregen);
+#endif
+	GamePregenRequest();
 }
 
-
-//--------------------------------------------------------------------------------------------
-// GAME
-//--------------------------------------------------------------------------------------------
-
-// melody descriptions
-// measure 8:8
-float melodyHighDesc[] =
-{
-	MELODY_TONE, MIDI_C5, 2.0f, 0.0f, // silence
-	MELODY_TONE, MIDI_C5, 2.0f, 0.1f,
-	MELODY_TONE, MIDI_B4, 3.0f, 0.1f,
-	MELODY_TONE, MIDI_B4, 1.0f, 0.1f,
-
-	MELODY_TONE, MIDI_C5, 4.0f, 0.1f,
-	MELODY_TONE, MIDI_B4, 5.0f, 0.1f,
-
-	MELODY_TONE, MIDI_C5, 2.0f, 0.1f, // 1:8 late
-	MELODY_TONE, MIDI_B4, 3.0f, 0.1f,
-	MELODY_TONE, MIDI_B4, 1.0f, 0.1f,
-	MELODY_TONE, MIDI_C5, 1.0f, 0.1f,
-
-	MELODY_TONE, MIDI_G5, 2.0f, 0.1f,
-	MELODY_TONE, MIDI_C5, 1.0f, 0.1f,
-	MELODY_TONE, MIDI_B4, 7.0f, 0.1f,
-
-	MELODY_TONE, MIDI_C5, 2.0f, 0.1f, // 2:8 late
-	MELODY_TONE, MIDI_B4, 3.0f, 0.1f,
-	MELODY_TONE, MIDI_B4, 1.0f, 0.1f,
-
-	MELODY_TONE, MIDI_C5, 4.0f, 0.1f,
-	MELODY_TONE, MIDI_B4, 5.0f, 0.1f,
-
-	MELODY_TONE, MIDI_C5, 2.0f, 0.1f, // 1:8 late
-	MELODY_TONE, MIDI_B4, 3.0f, 0.1f,
-	MELODY_TONE, MIDI_B4, 1.0f, 0.1f,
-	MELODY_TONE, MIDI_C5, 1.0f, 0.1f,
-
-	MELODY_TONE, MIDI_G5, 2.0f, 0.1f,
-	MELODY_TONE, MIDI_C5, 1.0f, 0.1f,
-	MELODY_TONE, MIDI_B4, 4.0f, 0.1f, // 7:8 syncope
-	
-    MELODY_END
-};
-
-float melodyHighEndDesc[] =
+void GamePregenClose(void)
 {
-	MELODY_TONE, MIDI_G3, 0.5f, 0, // silence
-	MELODY_TONE, MIDI_G3, 0.5f, 0.3f,
-	MELODY_TONE, MIDI_A3, 0.5f, 0.3f,
-	MELODY_TONE, MIDI_B3, 0.5f, 0.3f,
-	MELODY_TONE, MIDI_C4, 0.5f, 0.3f,
-	MELODY_TONE, MIDI_B3, 0.5f, 0.3f,
-	MELODY_TONE, MIDI_E4, 0.5f, 0.3f,
-	MELODY_TONE, MIDI_G4, 0.5f, 0.3f,
-	MELODY_TONE, MIDI_C5, 4.0f, 0.3f,
-    
-    MELODY_END
-};
-
-float melodyBassDesc[] =
-{
-	MELODY_TONE, MIDI_A1, 1.6f, 0.7f,
-	MELODY_TONE, MIDI_E2, 1.4f, 0.7f,
-	MELODY_TONE, MIDI_A2, 1.0f, 0.5f,
-
-	MELODY_TONE, MIDI_A1, 1.6f, 0.7f,
-	MELODY_TONE, MIDI_E2, 1.4f, 0.7f,
-	MELODY_TONE, MIDI_A2, 1.0f, 0.5f,
-
-	MELODY_TONE, MIDI_B1, 1.6f, 0.7f,
-	MELODY_TONE, MIDI_F2, 1.4f, 0.7f,
-	MELODY_TONE, MIDI_B2, 1.0f, 0.5f,
-
-	MELODY_TONE, MIDI_F2, 1.6f, 0.7f,
-	MELODY_TONE, MIDI_B2, 1.4f, 0.7f,
-	MELODY_TONE, MIDI_E3, 1.0f, 0.5f,
-    
-    MELODY_END
-};
-
-float melodyBassEndDesc[] =
-{
-	MELODY_TONE, MIDI_E1, 1.6f, 0.7f,
-	MELODY_TONE, MIDI_F1a, 1.4f, 0.5f,
-	MELODY_TONE, MIDI_G1, 1.0f, 0.5f,
-	MELODY_TONE, MIDI_A2, 4.0f, 0.7f,
-    
-    MELODY_END
-};
-
-float melodyClaveDesc[] =
-{
-	MELODY_HIT, 0, 0.555f, 0.10f,
-	MELODY_HIT, 0, 0.755f, 0.07f,
-	MELODY_HIT, 0, 0.555f, 0.15f,
-	MELODY_HIT, 0, 0.370f, 0.07f,
-	MELODY_HIT, 0, 0.750f, 0.10f,
-    
-    MELODY_END
-};
-
-float melodyClaveEndDesc[] =
-{
-	MELODY_HIT, 0, 0.555f, 0.10f,
-	MELODY_HIT, 0, 0.555f, 0.07f,
-	MELODY_HIT, 0, 8.755f, 0.15f,
-	0
-};
-
-float melodyBonusDesc[] =
-{
-	MELODY_TONE, MIDI_A4, 0.2f, 0.3f,
-	MELODY_TONE, MIDI_B4, 0.2f, 0.4f,
-	MELODY_TONE, MIDI_C5a, 1.0f, 0.5f,
-    
-    MELODY_END
-};
-
-float melodyOpenDesc[] =
-{
-	MELODY_NOISE, 0, 2.0f, 0.25f,
-    
-    MELODY_END
-};
-
-// melodies
-MELODY *gMelodyHigh = NULL;
-MELODY *gMelodyHighEnd = NULL;
-MELODY *gMelodyBass = NULL;
-MELODY *gMelodyBassEnd = NULL;
-MELODY *gMelodyClave = NULL;
-MELODY *gMelodyClaveEnd = NULL;
-MELODY *gMelodyBonus = NULL;
-MELODY *gMelodyOpen = NULL;
-
-// grid pointers
-GRID *gGrid = NULL;
-CELL *gCell = NULL; // current cell
-
-#define MOVE_STEP                0.12f
-#define SELECTOR_MIN             2
-#define SELECTOR_MAX             8
-int gSizeSelector = 4;
-
-enum GameStates
-{
-	GAME_MAIN,
-	GAME_WIN,
-	GAME_RUN,
-	GAME_STATES_COUNT
-};
-
-int gState = GAME_MAIN;
-float gSpeed = 0;
-int gBonus = 0; // collected
-float gHudBlink = 0;
+	if (gPregen.thread != NULL)
+	{
+		MutexLock(gPregen.mutex);
+		gPregen.quit = 1;
+		CondBroadcast(gPregen.cond);
+		MutexUnlock(gPregen.mutex);
+		ThreadJoin(gPregen.thread);
+	}
+	PregenFree(&gPregen.maze);
+	if (gPregen.mutex != NULL)
+		MutexRemove(gPregen.mutex);
+	if (gPregen.cond != NULL)
+		CondRemove(gPregen.cond);
+}
 
 void GameInit(void)
 {
 	SetExitKey(0);
 
+	unsigned long long _seed = (unsigned long long)time(NULL);
+#ifdef MAZE_HEADLESS
+	_seed = HeadlessSeed(_seed);
+#endif
+	GeneratorInit(&gGenerator, _seed);
+	GENERATOR _noise = gGenerator; // own random stream of the noise synthesis, apart from the mazes
+	GeneratorJump(&_noise);
+	SynthInit(&_noise);
+	GamePregenInit();
+
+	FrameInit(&gFrame, CellColors, (FRAMECOLOR) { 0, 0, 0, 255 });
+	Image _image = GenImageColor(FRAME_WIDTH, FRAME_HEIGHT, BLACK); // R8G8B8A8, the layout of the frame
+	gFrameTexture = LoadTextureFromImage(_image);
+	UnloadImage(_image);
+
 	InitAudioDevice();
 
+	MixerInit(&gMixer);
+	MixerQueueInit(&gMixerQueue);
 	if (IsAudioDeviceReady())
 	{
-		gMelodyHigh = MelodyCreate(melodyHighDesc);
-		gMelodyHighEnd = MelodyCreate(melodyHighEndDesc);
-		gMelodyBass = MelodyCreate(melodyBassDesc);
-		gMelodyBassEnd = MelodyCreate(melodyBassEndDesc);
-		gMelodyClave = MelodyCreate(melodyClaveDesc);
-		gMelodyClaveEnd = MelodyCreate(melodyClaveEndDesc);
-		gMelodyBonus = MelodyCreate(melodyBonusDesc);
-		gMelodyOpen = MelodyCreate(melodyOpenDesc);
+		if (SoundtrackCreate(&gSoundtrack, &gMixer))
+		{
+			gMelodyHigh = &gSoundtrack.melodies[VOICE_HIGH];
+			gMelodyHighEnd = &gSoundtrack.melodies[VOICE_HIGH_END];
+			gMelodyBass = &gSoundtrack.melodies[VOICE_BASS];
+			gMelodyBassEnd = &gSoundtrack.melodies[VOICE_BASS_END];
+			gMelodyClave = &gSoundtrack.melodies[VOICE_CLAVE];
+			gMelodyClaveEnd = &gSoundtrack.melodies[VOICE_CLAVE_END];
+			gMelodyBonus = &gSoundtrack.melodies[VOICE_BONUS];
+			gMelodyOpen = &gSoundtrack.melodies[VOICE_OPEN];
+		}
+
+		SetAudioStreamBufferSizeDefault(AUDIO_BLOCK);
+		gStream = InitAudioStream(SYNTH_SAMPLE_RATE, 16, 1);
+		AudioUpdate();
+		PlayAudioStream(gStream);
+#ifndef MAZE_HEADLESS // updated by the game loop, a script replays the same samples
+		gAudioThread = ThreadCreate(AudioWorker, NULL);
+#endif
 	}
 }
 
 void GameReset(void)
 {
-	if (gGrid != NULL)
+	if (gPvs != NULL)
+		PvsRemove(gPvs);
+	gPvs = NULL;
+	if (gWorld != NULL)
+		WorldRemove(gWorld);
+	else if (gGrid != NULL)
 		GridRemove(gGrid);
+	gWorld = NULL;
 	gGrid = NULL;
-	gCell = NULL;
+	gCell = 0;
 	gState = GAME_MAIN;
+	gStartPending = false;
 	gBonus = 0;
 	gHudBlink = 0;
 	gSpeed = 0;
@@ -1172,62 +480,62 @@ void GameReset(void)
 
 void GameClose(void)
 {
-	MelodyRemove(gMelodyOpen);
-	MelodyRemove(gMelodyBonus);
-	MelodyRemove(gMelodyClaveEnd);
-	MelodyRemove(gMelodyClave);
-	MelodyRemove(gMelodyBassEnd);
-	MelodyRemove(gMelodyBass);
-	MelodyRemove(gMelodyHighEnd);
-	MelodyRemove(gMelodyHigh);
-
-	if (gGrid != NULL)
+	if (gAudioThread != NULL)
+	{
+		AtomicStore(&gAudioQuit, 1);
+		ThreadJoin(gAudioThread);
+		gAudioThread = NULL;
+	}
+	SoundtrackRemove(&gSoundtrack, &gMixer);
+	if (IsAudioDeviceReady())
+		CloseAudioStream(gStream);
+
+	GamePregenClose();
+	if (gPvs != NULL)
+		PvsRemove(gPvs);
+	if (gWorld != NULL)
+		WorldRemove(gWorld);
+	else if (gGrid != NULL)
 		GridRemove(gGrid);
 
+	UnloadTexture(gFrameTexture);
 	CloseAudioDevice();
 }
 
-void GameMazeCreate()
+void GameVisibility(void)
 {
-	float _size = 11 + pow(2, gSizeSelector);
-	float _prop = (float)GetRandomValue(7, 13) / 10.0f;
-	gGrid = GridCreate(max(_size * _prop, 9), max(_size / _prop, 9));
-	gCell = GridMaze(gGrid);
-	GridFloodVisibility(gCell, MAZE_VISIBILITY_MAX, (float)GetTime());
-	gBonus = 0;
+	PROFILE_BEGIN(PROFILE_VISIBILITY);
+	if ((gPvs == NULL) || !PvsApply(gPvs, gGrid, gCell))
+		GridFloodVisibility(gGrid, gCell, MAZE_VISIBILITY_MAX);
+	PROFILE_END(PROFILE_VISIBILITY);
 }
 
 void Move(int _dir, float *_speed, float _timeStep)
 {
 	*_speed += _timeStep;
-	CELL *_cell = gCell + gGrid->ptrOffsets4[_dir];
+	int _cell = gCell + gGrid->cellOffsets4[_dir];
 	if (*_speed > MOVE_STEP)
 	{
 		*_speed -= MOVE_STEP;
-        if (_cell->type <= CT_WALL)
+        if (gGrid->types[_cell] <= CT_WALL)
             return;
         
-		switch (_cell->type)
+		switch (gGrid->types[_cell])
 		{
 		case CT_DOOR:
 		{
-			if (IsAudioDeviceReady())
-			{
-				MelodyStop(gMelodyOpen);
-				MelodyPlay(gMelodyOpen, _timeStep);
-			}
-
-			_cell->type = CT_OPEN;
-		} break;
+			MelodyPlay(gMelodyOpen);
+			gGrid->types[_cell] = CT_OPEN;
+			PROFILE_BEGIN(PROFILE_VISIBILITY);
+			GridVisibilityOpen(gGrid, _cell); // the player stays, only the view through the door changes
+			PROFILE_END(PROFILE_VISIBILITY);
+			return;
+		}
 
 		case CT_BONUS:
 		{
-			if (IsAudioDeviceReady())
-			{
-				MelodyStop(gMelodyBonus);
-				MelodyPlay(gMelodyBonus, _timeStep);
-			}
-			_cell->type = CT_OPEN;
+			MelodyPlay(gMelodyBonus);
+			gGrid->types[_cell] = CT_OPEN;
 			gBonus += 1;
 			gCell = _cell;
 		} break;
@@ -1235,7 +543,13 @@ void Move(int _dir, float *_speed, float _timeStep)
 		case CT_END:
 		{
 			if (gBonus == gGrid->bonus)
+			{
 				gState = GAME_WIN;
+				MelodyStop(gMelodyClave);
+				MelodyStop(gMelodyBass);
+				MelodyStop(gMelodyHigh);
+				MelodyPlay(gMelodyHighEnd); // the bass and the clave end follow
+			}
 			else
 				gHudBlink = 5;
 			gCell = _cell;
@@ -1247,7 +561,9 @@ void Move(int _dir, float *_speed, float _timeStep)
 		} break;
 		}
 
-		GridFloodVisibility(gCell, MAZE_VISIBILITY_MAX, (float)GetTime());
+		if (gWorld != NULL)
+			gCell = WorldFollow(gWorld, gCell);
+		GameVisibility();
 	}
 }
 
@@ -1256,94 +572,94 @@ bool GameLoop(void)
 	static float _speed = 1.0f;
 	float _timeStep = GetFrameTime();
 
+	if (gAudioThread == NULL)
+	{
+		PROFILE_BEGIN(PROFILE_MELODY);
+		AudioUpdate();
+		PROFILE_END(PROFILE_MELODY);
+	}
+
 	switch (gState)
 	{
 	case GAME_RUN:
 	{
 		// melody
-		if (IsAudioDeviceReady())
-		{
-			if (!MelodyLoop(gMelodyHigh, _timeStep))
-			{
-				MelodyStop(gMelodyBass); // syncronize
-				MelodyStop(gMelodyClave);
-			}
-			if (!MelodyLoop(gMelodyBass, _timeStep))
-				MelodyStop(gMelodyClave); // syncronize
-			MelodyLoop(gMelodyClave, _timeStep);
-
-			// fx
-			if (IsMelodyPlaying(gMelodyBonus))
-				MelodyPlay(gMelodyBonus, _timeStep);
-			if (IsMelodyPlaying(gMelodyOpen))
-				MelodyPlay(gMelodyOpen, _timeStep);
-		}
+		if (!IsMelodyPlaying(gMelodyHigh))
+			MelodyPlay(gMelodyHigh); // the bass and the clave follow
 
 		// update
+		PROFILE_BEGIN(PROFILE_INPUT);
+		int _dir = -1;
 		if (IsKeyDown(KEY_UP) || IsKeyDown(KEY_W) || IsKeyDown(KEY_I))
-			Move(GRID_UP, &_speed, _timeStep);
+			_dir = GRID_UP;
 		else if (IsKeyDown(KEY_DOWN) || IsKeyDown(KEY_S) || IsKeyDown(KEY_K))
-			Move(GRID_DOWN, &_speed, _timeStep);
+			_dir = GRID_DOWN;
 		else if (IsKeyDown(KEY_RIGHT) || IsKeyDown(KEY_D) || IsKeyDown(KEY_L))
-			Move(GRID_RIGHT, &_speed, _timeStep);
+			_dir = GRID_RIGHT;
 		else if (IsKeyDown(KEY_LEFT) || IsKeyDown(KEY_A) || IsKeyDown(KEY_J))
-			Move(GRID_LEFT, &_speed, _timeStep);
+			_dir = GRID_LEFT;
+
+#ifdef MAZE_PROFILE
+		if (IsKeyPressed(KEY_F3))
+			ProfileToggle();
+#endif
+		PROFILE_END(PROFILE_INPUT);
+
+		PROFILE_BEGIN(PROFILE_MOVE);
+		if (_dir >= 0)
+			Move(_dir, &_speed, _timeStep);
 		else
 			_speed = MOVE_STEP;
-        
+
+        // the mark lands on the cell reached by the move
         if(IsKeyPressed(KEY_SPACE))
         {
-            if (gCell->type == CT_MARK)
-                gCell->type = CT_OPEN;
-            else if ((gCell->type >= CT_OPEN) || (gCell->type == CT_ROOM_CENTER) || (gCell->type == CT_ROOM_BORDER))
-                gCell->type = CT_MARK;
+            unsigned char *_type = gGrid->types + gCell;
+            if (*_type == CT_MARK)
+                *_type = CT_OPEN;
+            else if ((*_type >= CT_OPEN) || (*_type == CT_ROOM_CENTER) || (*_type == CT_ROOM_BORDER))
+                *_type = CT_MARK;
         }
+		PROFILE_END(PROFILE_MOVE);
 
 		// maze
-		int _offX = 15 - gCell->posX;
-		int _offY = 16 - gCell->posY;
-		int _x0 = max(0, gCell->posX - 15);
-		int _xL = min(gGrid->width, gCell->posX + 16);
-		int _y = max(0, gCell->posY - 16);
-		int _yL = min(gGrid->height, gCell->posY + 16);
-		for (; _y < _yL; _y += 1)
-		{
-			for (int _x = _x0; _x < _xL; _x += 1)
-			{
-				CELL *_cellT = GETCELL(gGrid, _x, _y);
-				if (_cellT->depth <= 0)
-					continue;
-				Color *_col = CellColors + (long)min(_cellT->type, CT_LAST_COLOR);
-				_col->a = 255 * _cellT->depth / MAZE_VISIBILITY_MAX;
-				DrawRectangle(_x + _offX, _y + _offY, 1, 1, *_col);
-			}
-		}
+		PROFILE_BEGIN(PROFILE_DRAW);
+		FrameClear(&gFrame);
+		FrameMaze(&gFrame, gGrid, gCell);
 
 		// bonus bar
-		CellColors[CT_BONUS].a = 255;
-		int _bonus = gBonus * 30 / gGrid->bonus;
+		bool _full = (gWorld == NULL) && (gBonus == gGrid->bonus);
+		int _bonus = (gWorld != NULL) ? gBonus % 31 : gBonus * 30 / gGrid->bonus; // the endless bar fills at 30 bonuses and starts over on the 31st
 		if (gHudBlink > 0)
 		{
 			if ((int)gHudBlink % 2 < 1)
-				DrawRectangle(31, 0, 1, 32 - _bonus, CellColors[CT_BONUS]);
+				FrameRect(&gFrame, 31, 0, 1, 32 - _bonus, CellColors[CT_BONUS]);
 			else
-				DrawRectangle(31, 0, 1, 32 - _bonus, RED);
+				FrameRect(&gFrame, 31, 0, 1, 32 - _bonus, HUD_BAR_BLINK);
 			gHudBlink -= GetFrameTime() * 5.0f;
 		}
 		else
 		{
-			DrawRectangle(31, 0, 1, 32 - _bonus, (Color) { 60, 60, 0, 255 });
+			FrameRect(&gFrame, 31, 0, 1, 32 - _bonus, HUD_BAR_EMPTY);
 		}
 		if (gBonus > 0)
 		{
-			DrawRectangle(31, 31 - _bonus, 1, _bonus, CellColors[CT_BONUS]);
-			DrawRectangle(31, 31, 1, 1, CellColors[CT_BONUS]);
-			if (gBonus == gGrid->bonus)
-				DrawRectangle(31, 0, 1, 1, CellColors[CT_BONUS]);
+			FrameRect(&gFrame, 31, 31 - _bonus, 1, _bonus, CellColors[CT_BONUS]);
+			FrameRect(&gFrame, 31, 31, 1, 1, CellColors[CT_BONUS]);
+			if (_full)
+				FrameRect(&gFrame, 31, 0, 1, 1, CellColors[CT_BONUS]);
 		}
 
 		// player
-		DrawRectangle(gCell->posX + _offX, gCell->posY + _offY, 1, 1, WHITE);
+		FrameRect(&gFrame, 15, 16, 1, 1, PLAYER_COLOR);
+#ifdef MAZE_PROFILE
+		ProfileOverlay(&gFrame);
+#endif
+
+		// a single upload and draw of the whole screen
+		UpdateTexture(gFrameTexture, gFrame.pixels);
+		DrawTexture(gFrameTexture, 0, 0, WHITE);
+		PROFILE_END(PROFILE_DRAW);
 
 		// escape
 		if (IsKeyPressed(KEY_ESCAPE))
@@ -1354,15 +670,28 @@ bool GameLoop(void)
 	case GAME_MAIN:
 	{
 		// actions
+		int _selector = gSizeSelector;
 		if (IsKeyReleased(KEY_UP) || IsKeyReleased(KEY_W) || IsKeyReleased(KEY_I))
-		{
-			GameMazeCreate();
-			gState = GAME_RUN;
-		}
+			gStartPending = true;
 		else if (IsKeyPressed(KEY_RIGHT) || IsKeyPressed(KEY_D) || IsKeyPressed(KEY_L))
-			gSizeSelector = min(gSizeSelector + 1, SELECTOR_MAX);
+			gSizeSelector = min(gSizeSelector + 1, SELECTOR_ENDLESS);
 		else if (IsKeyPressed(KEY_LEFT) || IsKeyPressed(KEY_A) || IsKeyPressed(KEY_J))
 			gSizeSelector = max(gSizeSelector - 1, SELECTOR_MIN);
+		if (gSizeSelector != _selector)
+			GamePregenRequest();
+
+		// start as soon as the maze is ready, the frame never waits for it
+		if (gStartPending)
+		{
+			int _taken = GamePregenTake();
+			if (_taken != 0)
+				gStartPending = false;
+			if (_taken > 0)
+			{
+				gBonus = 0;
+				gState = GAME_RUN;
+			}
+		}
 
 		// screen
 		DrawRectangle(0, 0, 32, 1, WHITE);
@@ -1371,47 +700,57 @@ bool GameLoop(void)
 		DrawRectangle(31, 1, 1, 30, WHITE);
 		DrawTextEx(GetFontDefault(), "maze", (Vector2) { 2, 32 - GetFontDefault().baseSize }, GetFontDefault().baseSize, 1, WHITE);
 
-		// arrows
-		DrawLine(16, 11 - gSizeSelector, 14, 13 - gSizeSelector, WHITE);
-		DrawLine(16, 11 - gSizeSelector, 18, 13 - gSizeSelector, WHITE);
+		// arrows, the endless selector keeps the frame of the biggest size
+		_selector = min(gSizeSelector, SELECTOR_MAX);
+		DrawLine(16, 11 - _selector, 14, 13 - _selector, gStartPending ? DARKGRAY : WHITE); // waiting for the maze
+		DrawLine(16, 11 - _selector, 18, 13 - _selector, gStartPending ? DARKGRAY : WHITE);
 		if (gSizeSelector > SELECTOR_MIN)
 		{
-			DrawLine(11 - gSizeSelector, 15, 13 - gSizeSelector, 13, WHITE);
-			DrawLine(11 - gSizeSelector, 15, 13 - gSizeSelector, 17, WHITE);
+			DrawLine(11 - _selector, 15, 13 - _selector, 13, WHITE);
+			DrawLine(11 - _selector, 15, 13 - _selector, 17, WHITE);
 		}
 		else
 		{
-			DrawLine(11 - gSizeSelector, 15, 13 - gSizeSelector, 13, DARKGRAY);
-			DrawLine(11 - gSizeSelector, 15, 13 - gSizeSelector, 17, DARKGRAY);
+			DrawLine(11 - _selector, 15, 13 - _selector, 13, DARKGRAY);
+			DrawLine(11 - _selector, 15, 13 - _selector, 17, DARKGRAY);
 		}
-		if (gSizeSelector < SELECTOR_MAX)
+		if (gSizeSelector < SELECTOR_ENDLESS)
 		{
-			DrawLine(21 + gSizeSelector, 15, 19 + gSizeSelector, 13, WHITE);
-			DrawLine(21 + gSizeSelector, 15, 19 + gSizeSelector, 17, WHITE);
+			DrawLine(21 + _selector, 15, 19 + _selector, 13, WHITE);
+			DrawLine(21 + _selector, 15, 19 + _selector, 17, WHITE);
 		}
 		else
 		{
-			DrawLine(21 + gSizeSelector, 15, 19 + gSizeSelector, 13, DARKGRAY);
-			DrawLine(21 + gSizeSelector, 15, 19 + gSizeSelector, 17, DARKGRAY);
+			DrawLine(21 + _selector, 15, 19 + _selector, 13, DARKGRAY);
+			DrawLine(21 + _selector, 15, 19 + _selector, 17, DARKGRAY);
 		}
 
 		// maze size
-		int _minX = 16 - gSizeSelector;
-		int _minY = 15 - gSizeSelector;
-		int _maxX = _minX + gSizeSelector * 2 - 1;
-		int _maxY = _minY + gSizeSelector * 2 - 1;
-		int _size = gSizeSelector * 2 - 1;
+		int _minX = 16 - _selector;
+		int _minY = 15 - _selector;
+		int _maxX = _minX + _selector * 2 - 1;
+		int _maxY = _minY + _selector * 2 - 1;
+		int _size = _selector * 2 - 1;
 
 		DrawRectangle(_minX + 1, _minY, _size, 1, WHITE);
 		DrawRectangle(_minX, _maxY, _size, 1, WHITE);
 		DrawRectangle(_minX, _minY, 1, _size, WHITE);
 		DrawRectangle(_maxX, _minY + 1, 1, _size, WHITE);
 
-		for (int _x = 0; _x < gSizeSelector - SELECTOR_MIN; _x += 1)
+		for (int _x = 0; _x < _selector - SELECTOR_MIN; _x += 1)
 		{
 			DrawRectangle(_minX + 2 + _x * 2, _maxY - 2, 1, 1, WHITE);
 		}
 
+		// endless, passages out of the frame on every side
+		if (gSizeSelector == SELECTOR_ENDLESS)
+		{
+			DrawRectangle(_minX + _size / 2, _minY, 3, 1, BLACK);
+			DrawRectangle(_minX + _size / 2 - 1, _maxY, 3, 1, BLACK);
+			DrawRectangle(_minX, _minY + _size / 2 - 1, 1, 3, BLACK);
+			DrawRectangle(_maxX, _minY + _size / 2, 1, 3, BLACK);
+		}
+
 		// escape
 		if (IsKeyPressed(KEY_ESCAPE))
 			return false;
@@ -1421,17 +760,8 @@ bool GameLoop(void)
 	case GAME_WIN:
 	{
 		// melody
-		if (IsAudioDeviceReady())
-		{
-			MelodyPlay(gMelodyHighEnd, _timeStep);
-			MelodyPlay(gMelodyClaveEnd, _timeStep);
-			if (!MelodyPlay(gMelodyBassEnd, _timeStep))
-				GameReset();
-		}
-		else
-		{
+		if (!IsMelodyPlaying(gMelodyBassEnd))
 			GameReset();
-		}
 
 		// screen
 		DrawRectangle(0, 0, 32, 1, WHITE);
@@ -1474,6 +804,9 @@ int main(void) {
 
 	//----------------------------------------------------------------------------------
 	GameInit();
+#ifdef MAZE_PROFILE
+	ProfileInit();
+#endif
 	//----------------------------------------------------------------------------------
 
 	SetTargetFPS(60);               // Set our game to run at 60 frames-per-second
@@ -1508,6 +841,7 @@ int main(void) {
 		EndTextureMode();
 
 		// Draw render texture to window, properly scaled
+		PROFILE_BEGIN(PROFILE_PRESENT);
 		DrawTexturePro(
 			target.texture,
 			(Rectangle) {
@@ -1530,6 +864,10 @@ int main(void) {
 		for (int y = -1; y < renderHeight; y += 16) DrawRectangle(_renderX, y + _renderY, renderWidth, 2, BLACK);
 
 		EndDrawing();
+		PROFILE_END(PROFILE_PRESENT);
+#ifdef MAZE_PROFILE
+		ProfileFrame();
+#endif
 
 		//--------------------------------------------------------------------------------------
 	}
@@ -1538,6 +876,9 @@ int main(void) {
 	//--------------------------------------------------------------------------------------
 
 	//----------------------------------------------------------------------------------
+#ifdef MAZE_PROFILE
+	ProfileClose();
+#endif
 	GameClose();
 	//----------------------------------------------------------------------------------
 
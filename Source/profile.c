@@ -0,0 +1,174 @@
+/**********************************************************************************************
+*
+*   profile - per phase frame timing
+*
+*   LICENSE: zlib/libpng
+*
+*   Copyright (c) 2020 Jose Miguel Rodriguez Chavarri (https://github.com/txesmi/)
+*
+**********************************************************************************************/
+
+#include "profile.h"
+#include "thread.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define max(a, b) ((a) > (b) ? (a) : (b))
+#define min(a, b) ((a) < (b) ? (a) : (b))
+
+#define PROFILE_OVERLAY_SHADE     (FRAMECOLOR) { 0, 0, 0, 190 }
+#define PROFILE_OVERLAY_NAME      (FRAMECOLOR) { 0, 200, 255, 255 }
+#define PROFILE_OVERLAY_TEXT      (FRAMECOLOR) { 255, 255, 255, 255 }
+
+//--------------------------------------------------------------------------------------------
+// PROFILE
+//--------------------------------------------------------------------------------------------
+
+static const char *ProfileNames[PROFILE_PHASES] = { "input", "move", "visibility", "draw", "melody", "present", "frame" };
+static const char *ProfileLabels[PROFILE_PHASES] = { "input", "move", "vis", "draw", "melody", "present", "frame" }; // 8 characters fit the frame
+
+typedef struct
+{
+	PROFILESAMPLE samples[PROFILE_SAMPLES];
+	volatile int head; // samples pushed, wrapping, the ring index in the low bits
+	volatile int full; // set once the ring holds PROFILE_SAMPLES - 1 samples, before head can wrap
+	long long frames; // only for the frame thread
+	double starts[PROFILE_PHASES];
+	double frameStart;
+	PROFILESAMPLE current; // the frame under way
+	int overlay; // shown phase + 1, 0 when hidden
+} PROFILE;
+
+static PROFILE gProfile;
+
+void ProfileInit(void)
+{
+	memset(&gProfile, 0, sizeof(PROFILE));
+	gProfile.frameStart = MazeTime();
+}
+
+void ProfileBegin(int _phase)
+{
+	gProfile.starts[_phase] = MazeTime();
+}
+
+void ProfileEnd(int _phase)
+{
+	gProfile.current.ms[_phase] += (float)(1000.0 * (MazeTime() - gProfile.starts[_phase]));
+}
+
+void ProfileFrame(void)
+{
+	double _time = MazeTime();
+	gProfile.current.ms[PROFILE_FRAME] = (float)(1000.0 * (_time - gProfile.frameStart));
+	gProfile.frameStart = _time;
+	gProfile.samples[(unsigned int)gProfile.head & (PROFILE_SAMPLES - 1)] = gProfile.current;
+	if (AtomicAdd(&gProfile.head, 1) + 1 == PROFILE_SAMPLES - 1) // publishes the sample
+		AtomicStore(&gProfile.full, 1);
+	gProfile.frames += 1;
+	memset(&gProfile.current, 0, sizeof(PROFILESAMPLE));
+}
+
+int ProfileLatest(PROFILESAMPLE *_samples, int _count)
+{
+	// full first, a head loaded while the ring is not full yet is still the count of samples
+	bool _full = AtomicLoad(&gProfile.full) != 0;
+	unsigned int _head = (unsigned int)AtomicLoad(&gProfile.head);
+	// the slot after the head may be under the writer already
+	int _available = _full ? PROFILE_SAMPLES - 1 : (int)min(_head, (unsigned int)(PROFILE_SAMPLES - 1));
+	_count = min(_count, _available);
+	for (int _i = 0; _i < _count; _i += 1)
+		_samples[_i] = gProfile.samples[(_head - (unsigned int)_count + (unsigned int)_i) & (PROFILE_SAMPLES - 1)];
+	return _count;
+}
+
+static int ProfileCompare(const void *_a, const void *_b)
+{
+	float _x = *(const float*)_a;
+	float _y = *(const float*)_b;
+	return (_x > _y) - (_x < _y);
+}
+
+bool ProfileStats(int _phase, int _count, PROFILESTATS *_stats)
+{
+	static PROFILESAMPLE _samples[PROFILE_SAMPLES];
+	static float _ms[PROFILE_SAMPLES];
+	_count = ProfileLatest(_samples, min(_count, PROFILE_SAMPLES));
+	if (_count == 0)
+		return false;
+	for (int _i = 0; _i < _count; _i += 1)
+		_ms[_i] = _samples[_i].ms[_phase];
+	qsort(_ms, (size_t)_count, sizeof(float), ProfileCompare);
+	_stats->count = _count;
+	_stats->p50 = _ms[(_count - 1) * 50 / 100];
+	_stats->p99 = _ms[(_count - 1) * 99 / 100];
+	_stats->max = _ms[_count - 1];
+	return true;
+}
+
+bool ProfileSave(const char *_path)
+{
+	static PROFILESAMPLE _samples[PROFILE_SAMPLES];
+	FILE *_file = fopen(_path, "w");
+	if (_file == NULL)
+		return false;
+	int _count = ProfileLatest(_samples, PROFILE_SAMPLES);
+	fprintf(_file, "frame");
+	for (int _phase = 0; _phase < PROFILE_PHASES; _phase += 1)
+		fprintf(_file, ",%s_ms", ProfileNames[_phase]);
+	fprintf(_file, "\n");
+	for (int _i = 0; _i < _count; _i += 1)
+	{
+		fprintf(_file, "%lld", gProfile.frames - _count + _i);
+		for (int _phase = 0; _phase < PROFILE_PHASES; _phase += 1)
+			fprintf(_file, ",%.4f", _samples[_i].ms[_phase]);
+		fprintf(_file, "\n");
+	}
+	return (fclose(_file) == 0);
+}
+
+void ProfileClose(void)
+{
+	const char *_path = getenv("MAZE_PROFILE_CSV");
+	if (_path == NULL)
+		_path = PROFILE_CSV;
+	if (!ProfileSave(_path))
+		fprintf(stderr, "profile: could not write %s\n", _path);
+}
+
+//--------------------------------------------------------------------------------------------
+// OVERLAY
+//--------------------------------------------------------------------------------------------
+
+void ProfileToggle(void)
+{
+	gProfile.overlay = (gProfile.overlay + 1) % (PROFILE_PHASES + 1);
+}
+
+// milliseconds in 5 characters at most
+static void ProfileFormat(char *_text, size_t _size, const char *_label, float _ms)
+{
+	if (_ms < 10.0f)
+		snprintf(_text, _size, "%s %.2f", _label, _ms);
+	else if (_ms < 1000.0f)
+		snprintf(_text, _size, "%s %.1f", _label, _ms);
+	else
+		snprintf(_text, _size, "%s %.0f", _label, _ms);
+}
+
+void ProfileOverlay(FRAME *_frame)
+{
+	PROFILESTATS _stats;
+	if ((gProfile.overlay == 0) || !ProfileStats(gProfile.overlay - 1, PROFILE_WINDOW, &_stats))
+		return;
+	char _text[16];
+	FrameRect(_frame, 0, 0, FRAME_WIDTH, FRAME_FONT_LINE * 4 + 1, PROFILE_OVERLAY_SHADE);
+	FrameText(_frame, 1, 1, ProfileLabels[gProfile.overlay - 1], PROFILE_OVERLAY_NAME);
+	ProfileFormat(_text, sizeof(_text), "50", _stats.p50);
+	FrameText(_frame, 1, 1 + FRAME_FONT_LINE, _text, PROFILE_OVERLAY_TEXT);
+	ProfileFormat(_text, sizeof(_text), "99", _stats.p99);
+	FrameText(_frame, 1, 1 + FRAME_FONT_LINE * 2, _text, PROFILE_OVERLAY_TEXT);
+	ProfileFormat(_text, sizeof(_text), "mx", _stats.max);
+	FrameText(_frame, 1, 1 + FRAME_FONT_LINE * 3, _text, PROFILE_OVERLAY_TEXT);
+}
@@ -0,0 +1,86 @@
+/**********************************************************************************************
+*
+*   profile - per phase frame timing
+*
+*   The game brackets the phases of a frame with PROFILE_BEGIN and PROFILE_END. The time of
+*   every phase is added up over the frame, a phase may run several times in it, and
+*   ProfileFrame closes the frame pushing a sample with all of them into a ring holding the
+*   last PROFILE_SAMPLES frames. Phases may nest: the move includes the visibility update it
+*   triggers, the present includes the wait for vsync.
+*
+*   The ring has a single writer, the thread running the frames. The count of samples is
+*   published after each sample is complete, so readers on other threads find the latest
+*   samples whole without a lock.
+*
+*   The timers only exist in builds defining MAZE_PROFILE, the macros are empty otherwise.
+*
+*   LICENSE: zlib/libpng
+*
+*   Copyright (c) 2020 Jose Miguel Rodriguez Chavarri (https://github.com/txesmi/)
+*
+**********************************************************************************************/
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include "frame.h"
+#include <stdbool.h>
+
+//--------------------------------------------------------------------------------------------
+// DEFINES
+//--------------------------------------------------------------------------------------------
+
+#define PROFILE_SAMPLES           4096 // frames kept, a power of two
+#define PROFILE_WINDOW            240 // latest frames behind the overlay
+#define PROFILE_CSV               "maze-profile.csv" // saved on close without MAZE_PROFILE_CSV
+
+enum ProfilePhases
+{
+	PROFILE_INPUT,
+	PROFILE_MOVE,
+	PROFILE_VISIBILITY,
+	PROFILE_DRAW,
+	PROFILE_MELODY,
+	PROFILE_PRESENT,
+	PROFILE_FRAME, // the whole frame, from one ProfileFrame to the next
+	PROFILE_PHASES
+};
+
+#ifdef MAZE_PROFILE
+#define PROFILE_BEGIN(phase)      ProfileBegin(phase)
+#define PROFILE_END(phase)        ProfileEnd(phase)
+#else
+#define PROFILE_BEGIN(phase)      ((void)0)
+#define PROFILE_END(phase)        ((void)0)
+#endif
+
+//--------------------------------------------------------------------------------------------
+// PROFILE
+//--------------------------------------------------------------------------------------------
+
+typedef struct
+{
+	float ms[PROFILE_PHASES];
+} PROFILESAMPLE;
+
+typedef struct
+{
+	int count; // samples behind the figures
+	float p50;
+	float p99;
+	float max;
+} PROFILESTATS;
+
+void ProfileInit(void);
+void ProfileBegin(int _phase);
+void ProfileEnd(int _phase);
+void ProfileFrame(void); // pushes the sample of the frame and starts the next one
+int ProfileLatest(PROFILESAMPLE *_samples, int _count); // copies up to _count latest samples, the oldest first, returns how many
+bool ProfileStats(int _phase, int _count, PROFILESTATS *_stats); // over the latest _count frames, false without samples
+bool ProfileSave(const char *_path); // every sample in the ring as CSV, false when the file can not be written
+void ProfileClose(void); // saves the CSV to MAZE_PROFILE_CSV or PROFILE_CSV, failures reported on stderr
+
+void ProfileToggle(void); // hidden, then a phase after the other, then hidden again
+void ProfileOverlay(FRAME *_frame); // figures of the shown phase over the frame
+
+#endif // PROFILE_H
@@ -0,0 +1,297 @@
+/**********************************************************************************************
+*
+*   pvs - baked potentially visible sets
+*
+*   LICENSE: zlib/libpng
+*
+*   Copyright (c) 2020 Jose Miguel Rodriguez Chavarri (https://github.com/txesmi/)
+*
+**********************************************************************************************/
+
+#include "pvs.h"
+#include "thread.h"
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define max(a, b) ((a) > (b) ? (a) : (b))
+#define min(a, b) ((a) < (b) ? (a) : (b))
+
+#define PVS_RUN_HEADER  3 // row offset, column offset and length
+
+//--------------------------------------------------------------------------------------------
+// BAKE
+//--------------------------------------------------------------------------------------------
+
+typedef struct
+{
+	GRID *grid;
+	PVS *pvs;
+	int reach; // chebyshev distance of the furthest cell a flood can reach
+	volatile int nextRow;
+	signed char **rowData; // sets of every row, concatenated after the bake
+	int *rowBytes;
+} PVSBAKE;
+
+typedef struct
+{
+	PVSBAKE *bake;
+	int maxSet; // cells of the longest set baked by the worker
+	int failed;
+} PVSWORKER;
+
+// Every worker floods over its own depth and stamp layers and shares the static ones.
+static void PvsWorker(void *_data)
+{
+	PVSWORKER *_worker = (PVSWORKER*)_data;
+	PVSBAKE *_bake = _worker->bake;
+	GRID *_grid = _bake->grid;
+	PVS *_pvs = _bake->pvs;
+	int _reach = _bake->reach;
+
+	GRID _view = *_grid;
+	_view.depths = (signed char*)malloc((size_t)_grid->size);
+	_view.stamps = (unsigned short*)calloc((size_t)_grid->size, sizeof(unsigned short));
+	_view.stamp = 0;
+	_view.floodQueue = NULL;
+
+	int _capacity = 0;
+	signed char *_buffer = NULL;
+	if ((_view.depths == NULL) || (_view.stamps == NULL))
+		_worker->failed = 1;
+
+	while (!_worker->failed)
+	{
+		int _y = AtomicAdd(&_bake->nextRow, 1);
+		if (_y >= _grid->height)
+			break;
+
+		int _bytes = 0;
+		for (int _x = 0; (_x < _grid->width) && !_worker->failed; _x += 1)
+		{
+			int _cell = GETCELL(_grid, _x, _y);
+			_pvs->offsets[_cell] = _bytes; // relative to the row until the rows are concatenated
+			if (_grid->types[_cell] <= CT_WALL)
+				continue;
+
+			GridFloodVisibility(&_view, _cell, _pvs->depth);
+			if (_view.floodQueue == NULL)
+			{
+				_worker->failed = 1;
+				break;
+			}
+
+			// row runs of the cells stamped by the flood
+			int _set = 0;
+			int _x0 = max(_x - _reach, 0);
+			int _xL = min(_x + _reach + 1, _grid->width);
+			int _yL = min(_y + _reach + 1, _grid->height);
+			for (int _yT = max(_y - _reach, 0); _yT < _yL; _yT += 1)
+			{
+				int _xT = _x0;
+				while (_xT < _xL)
+				{
+					int _cellT = GETCELL(_grid, _xT, _yT);
+					if (_view.stamps[_cellT] != _view.stamp)
+					{
+						_xT += 1;
+						continue;
+					}
+
+					if (_bytes + PVS_RUN_HEADER + _xL - _x0 > _capacity)
+					{
+						int _capacityNew = max(_capacity * 2, 4096);
+						signed char *_bufferNew = (signed char*)realloc(_buffer, (size_t)_capacityNew);
+						if (_bufferNew == NULL)
+						{
+							_worker->failed = 1;
+							break;
+						}
+						_buffer = _bufferNew;
+						_capacity = _capacityNew;
+					}
+
+					signed char *_run = _buffer + _bytes;
+					_run[0] = (signed char)(_yT - _y);
+					_run[1] = (signed char)(_xT - _x);
+					int _length = 0;
+					for (; (_xT < _xL) && (_view.stamps[_cellT] == _view.stamp); _xT += 1, _cellT += 1)
+					{
+						_run[PVS_RUN_HEADER + _length] = _view.depths[_cellT];
+						_length += 1;
+					}
+					_run[2] = (signed char)(unsigned char)_length;
+					_bytes += PVS_RUN_HEADER + _length;
+					_set += _length;
+				}
+				if (_worker->failed)
+					break;
+			}
+			_worker->maxSet = max(_worker->maxSet, _set);
+		}
+		if (_worker->failed)
+			break;
+
+		_bake->rowData[_y] = (signed char*)malloc((size_t)max(_bytes, 1));
+		if (_bake->rowData[_y] == NULL)
+		{
+			_worker->failed = 1;
+			break;
+		}
+		if (_bytes > 0) // rows without walkable runs never grew the buffer
+			memcpy(_bake->rowData[_y], _buffer, (size_t)_bytes);
+		_bake->rowBytes[_y] = _bytes;
+	}
+
+	free(_buffer);
+	free(_view.floodQueue);
+	free(_view.stamps);
+	free(_view.depths);
+}
+
+PVS *PvsBake(GRID *_grid, int _depth, int _threads)
+{
+	PVS *_pvs = (PVS*)calloc(1, sizeof(PVS));
+	if (_pvs == NULL)
+		return NULL;
+	_pvs->width = _grid->width;
+	_pvs->size = _grid->size;
+	_pvs->depth = max(min(_depth, MAZE_VISIBILITY_MAX), MAZE_VISIBILITY_MIN);
+	_pvs->offsets = (int*)malloc(((size_t)_grid->size + 1) * sizeof(int));
+	_pvs->doors = (unsigned char*)calloc(((size_t)_grid->size + 7) / 8, 1);
+
+	PVSBAKE _bake;
+	_bake.grid = _grid;
+	_bake.pvs = _pvs;
+	_bake.reach = max(_pvs->depth - MAZE_VISIBILITY_END, 0) + 1; // the flood pushes the neighbors of the last cells it spreads from
+	_bake.nextRow = 0;
+	_bake.rowData = (signed char**)calloc((size_t)_grid->height, sizeof(signed char*));
+	_bake.rowBytes = (int*)calloc((size_t)_grid->height, sizeof(int));
+
+	if (_threads <= 0)
+		_threads = ThreadHardwareCount();
+	_threads = max(min(_threads, _grid->height), 1);
+	PVSWORKER *_workers = (PVSWORKER*)calloc((size_t)_threads, sizeof(PVSWORKER));
+	THREAD **_handles = (THREAD**)calloc((size_t)_threads, sizeof(THREAD*));
+
+	int _maxSet = 0;
+	int _failed = (_pvs->offsets == NULL) || (_pvs->doors == NULL) || (_bake.rowData == NULL) || (_bake.rowBytes == NULL) || (_workers == NULL) || (_handles == NULL);
+	if (!_failed)
+	{
+		for (int _cell = 0; _cell < _grid->size; _cell += 1)
+		{
+			if (_grid->types[_cell] == CT_DOOR)
+				_pvs->doors[_cell >> 3] |= (unsigned char)(1 << (_cell & 7));
+		}
+
+		// the calling thread is the first worker
+		for (int _i = 0; _i < _threads; _i += 1)
+			_workers[_i].bake = &_bake;
+		for (int _i = 1; _i < _threads; _i += 1)
+			_handles[_i] = ThreadCreate(PvsWorker, _workers + _i);
+		PvsWorker(_workers);
+		for (int _i = 1; _i < _threads; _i += 1)
+		{
+			if (_handles[_i] != NULL)
+				ThreadJoin(_handles[_i]);
+		}
+
+		for (int _i = 0; _i < _threads; _i += 1)
+		{
+			_failed |= _workers[_i].failed;
+			_maxSet = max(_maxSet, _workers[_i].maxSet);
+		}
+	}
+
+	// concatenate the rows
+	if (!_failed)
+	{
+		long long _bytes = 0;
+		for (int _y = 0; _y < _grid->height; _y += 1)
+			_bytes += _bake.rowBytes[_y];
+		_pvs->data = _bytes < INT_MAX ? (signed char*)malloc((size_t)max(_bytes, 1)) : NULL;
+		_pvs->opened = (int*)malloc((size_t)max(_maxSet, 1) * sizeof(int));
+		_failed = (_pvs->data == NULL) || (_pvs->opened == NULL);
+		if (!_failed)
+		{
+			int _offset = 0;
+			for (int _y = 0; _y < _grid->height; _y += 1)
+			{
+				memcpy(_pvs->data + _offset, _bake.rowData[_y], (size_t)_bake.rowBytes[_y]);
+				for (int _cell = GETCELL(_grid, 0, _y); _cell < GETCELL(_grid, 0, _y + 1); _cell += 1)
+					_pvs->offsets[_cell] += _offset;
+				_offset += _bake.rowBytes[_y];
+			}
+			_pvs->offsets[_grid->size] = _offset;
+			_pvs->bytes = _offset;
+		}
+	}
+
+	if (_bake.rowData != NULL)
+	{
+		for (int _y = 0; _y < _grid->height; _y += 1)
+			free(_bake.rowData[_y]);
+	}
+	free(_bake.rowData);
+	free(_bake.rowBytes);
+	free(_workers);
+	free(_handles);
+
+	if (_failed)
+	{
+		PvsRemove(_pvs);
+		return NULL;
+	}
+	return _pvs;
+}
+
+void PvsRemove(PVS *_pvs)
+{
+	free(_pvs->offsets);
+	free(_pvs->data);
+	free(_pvs->doors);
+	free(_pvs->opened);
+	free(_pvs);
+}
+
+//--------------------------------------------------------------------------------------------
+// APPLY
+//--------------------------------------------------------------------------------------------
+
+int PvsApply(PVS *_pvs, GRID *_grid, int _cell)
+{
+	if ((_grid->width != _pvs->width) || (_grid->size != _pvs->size) || (_cell < 0) || (_cell >= _pvs->size))
+		return 0;
+	const signed char *_run = _pvs->data + _pvs->offsets[_cell];
+	const signed char *_runL = _pvs->data + _pvs->offsets[_cell + 1];
+	if (_run == _runL)
+		return 0;
+
+	GridVisibilityBegin(_grid, _cell, _pvs->depth);
+	unsigned short _stamp = _grid->stamp;
+
+	int _opened = 0;
+	while (_run < _runL)
+	{
+		int _cellT = _cell + _run[0] * _grid->width + _run[1];
+		int _length = (unsigned char)_run[2];
+		_run += PVS_RUN_HEADER;
+		for (int _i = 0; _i < _length; _i += 1, _cellT += 1)
+		{
+			_grid->depths[_cellT] = _run[_i];
+			_grid->stamps[_cellT] = _stamp;
+
+			// doors opened after the bake
+			if ((_pvs->doors[_cellT >> 3] & (1 << (_cellT & 7))) && (_grid->types[_cellT] != CT_DOOR))
+			{
+				_pvs->opened[_opened] = _cellT;
+				_opened += 1;
+			}
+		}
+		_run += _length;
+	}
+
+	if (_opened > 0)
+		GridVisibilityOpenCells(_grid, _pvs->opened, _opened);
+	return 1;
+}
@@ -0,0 +1,44 @@
+/**********************************************************************************************
+*
+*   pvs - baked potentially visible sets
+*
+*   The maze does not change after GridMaze but for doors and bonuses, so the visibility
+*   flood from every walkable cell can be computed once, in parallel, and stored as a
+*   compressed set of depths. Applying a set writes the same depths and stamps a
+*   GridFloodVisibility from that cell would write. Doors opened after the bake are
+*   patched with an incremental flood from them.
+*
+*   LICENSE: zlib/libpng
+*
+*   Copyright (c) 2020 Jose Miguel Rodriguez Chavarri (https://github.com/txesmi/)
+*
+**********************************************************************************************/
+
+#ifndef PVS_H
+#define PVS_H
+
+#include "maze.h"
+
+//--------------------------------------------------------------------------------------------
+// PVS
+//--------------------------------------------------------------------------------------------
+
+// The set of a cell is a list of row runs: signed char row offset, signed char column
+// offset, unsigned char length, and a signed char depth for each cell of the run.
+typedef struct
+{
+	int width; // of the baked grid
+	int size;
+	int depth; // depth of the viewer
+	int *offsets; // size + 1, the set of a cell lies between its offset and the next one
+	signed char *data;
+	unsigned char *doors; // a bit per cell, CT_DOOR cells at bake time
+	int *opened; // scratch list of the doors to patch, as long as the longest set
+	int bytes; // size of data
+} PVS;
+
+PVS *PvsBake(GRID *_grid, int _depth, int _threads); // _threads <= 0 uses every core, NULL when out of memory
+void PvsRemove(PVS *_pvs);
+int PvsApply(PVS *_pvs, GRID *_grid, int _cell); // 0 when the cell has no set, flood it instead
+
+#endif // PVS_H
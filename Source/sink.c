@@ -0,0 +1,335 @@
+/**********************************************************************************************
+*
+*   sink - outputs of the finished 32x32 frames
+*
+*   LICENSE: zlib/libpng
+*
+*   Copyright (c) 2020 Jose Miguel Rodriguez Chavarri (https://github.com/txesmi/)
+*
+**********************************************************************************************/
+
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L // MSG_NOSIGNAL
+#endif
+
+#include "sink.h"
+#include "thread.h"
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#define max(a, b) ((a) > (b) ? (a) : (b))
+#define min(a, b) ((a) < (b) ? (a) : (b))
+
+//--------------------------------------------------------------------------------------------
+// SINK
+//--------------------------------------------------------------------------------------------
+
+void SinkLevels(SINK *_sink, float _gamma, float _brightness)
+{
+	_brightness = min(max(_brightness, 0.0f), 1.0f);
+	for (int _i = 0; _i < 256; _i += 1)
+		_sink->levels[_i] = (unsigned char)(255.0f * _brightness * powf((float)_i / 255.0f, _gamma) + 0.5f);
+}
+
+bool SinkSubmit(SINK *_sink, const FRAMECOLOR *_pixels)
+{
+	return _sink->submit(_sink, _pixels);
+}
+
+void SinkClose(SINK *_sink, SINKSTATS *_stats)
+{
+	SINKSTATS _dummy;
+	_sink->close(_sink, (_stats != NULL) ? _stats : &_dummy);
+}
+
+void SinkReport(const char *_name, const SINKSTATS *_stats)
+{
+	fprintf(stderr, "%s: %lld frames written, %lld dropped, latency %.3f ms average, %.3f ms max\n",
+		_name, _stats->written, _stats->dropped,
+		_stats->written > 0 ? 1000.0 * _stats->latency / (double)_stats->written : 0, 1000.0 * _stats->latencyMax);
+}
+
+// converts the pixels through the levels, the single pass over the frame
+static void SinkConvert(const SINK *_sink, const FRAMECOLOR *_pixels, unsigned char *_rgb)
+{
+	for (int _i = 0; _i < SINK_PIXELS; _i += 1, _rgb += 3)
+	{
+		_rgb[0] = _sink->levels[_pixels[_i].r];
+		_rgb[1] = _sink->levels[_pixels[_i].g];
+		_rgb[2] = _sink->levels[_pixels[_i].b];
+	}
+}
+
+//--------------------------------------------------------------------------------------------
+// DESCRIPTOR
+//--------------------------------------------------------------------------------------------
+
+typedef struct
+{
+	SINK sink;
+	char *target;
+	bool socket;
+	bool fifo;
+	bool drop; // frames are replaced instead of waited for
+	bool opened; // by the writer
+	int fd; // -1 until the writer opens the target
+	THREAD *thread;
+	MUTEX *mutex;
+	COND *cond;
+	unsigned char *buffers[2]; // a header and the RGB bytes
+	size_t header;
+	int pending; // buffer waiting for the writer, -1 for none
+	int writing; // buffer in the hands of the writer, -1 for none
+	double pendingTime; // submission of the pending buffer
+	bool quit;
+	bool released; // the target was opened by a reader of our own at close, nothing reads it
+	bool failed;
+	SINKSTATS stats;
+} SINKDESCRIPTOR;
+
+// false when the target can not be opened, called by the writer as FIFOs block until a reader comes
+static bool SinkDescriptorOpen(SINKDESCRIPTOR *_sink)
+{
+	if (strcmp(_sink->target, "-") == 0)
+	{
+		_sink->fd = 1;
+		return true;
+	}
+#ifdef _WIN32
+	if (_sink->socket)
+		return false;
+	_sink->fd = _open(_sink->target, _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, 0644);
+#else
+	if (_sink->socket)
+	{
+		struct sockaddr_un _address;
+		const char *_path = _sink->target + strlen(SINK_UNIX);
+		if (strlen(_path) >= sizeof(_address.sun_path))
+			return false;
+		memset(&_address, 0, sizeof(_address));
+		_address.sun_family = AF_UNIX;
+		strcpy(_address.sun_path, _path);
+		_sink->fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if ((_sink->fd >= 0) && (connect(_sink->fd, (struct sockaddr*)&_address, sizeof(_address)) != 0))
+		{
+			close(_sink->fd);
+			_sink->fd = -1;
+		}
+	}
+	else
+		_sink->fd = open(_sink->target, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+#endif
+	return _sink->fd >= 0;
+}
+
+static bool SinkDescriptorWrite(SINKDESCRIPTOR *_sink, const unsigned char *_data, size_t _bytes)
+{
+	while (_bytes > 0)
+	{
+#ifdef _WIN32
+		long long _done = _write(_sink->fd, _data, (unsigned int)_bytes);
+#else
+		long long _done = _sink->socket ? send(_sink->fd, _data, _bytes, MSG_NOSIGNAL) : write(_sink->fd, _data, _bytes);
+#endif
+		if ((_done < 0) && (errno == EINTR))
+			continue;
+		if (_done <= 0)
+			return false;
+		_data += _done;
+		_bytes -= (size_t)_done;
+	}
+	return true;
+}
+
+static void SinkDescriptorWriter(void *_data)
+{
+	SINKDESCRIPTOR *_sink = (SINKDESCRIPTOR*)_data;
+	bool _opened = SinkDescriptorOpen(_sink);
+	MutexLock(_sink->mutex);
+	_sink->opened = true;
+	if (!_opened)
+	{
+		fprintf(stderr, "sink: could not open %s, no frames written\n", _sink->target);
+		_sink->failed = true;
+	}
+	while (!_sink->failed && !_sink->released)
+	{
+		if (_sink->pending < 0)
+		{
+			if (_sink->quit)
+				break;
+			CondWait(_sink->cond, _sink->mutex);
+			continue;
+		}
+		int _buffer = _sink->pending;
+		double _time = _sink->pendingTime;
+		_sink->pending = -1;
+		_sink->writing = _buffer;
+		CondBroadcast(_sink->cond);
+		MutexUnlock(_sink->mutex);
+
+		bool _ok = SinkDescriptorWrite(_sink, _sink->buffers[_buffer], _sink->header + SINK_RGB_BYTES);
+		_time = MazeTime() - _time;
+
+		MutexLock(_sink->mutex);
+		_sink->writing = -1;
+		if (_ok)
+		{
+			_sink->stats.written += 1;
+			_sink->stats.latency += _time;
+			_sink->stats.latencyMax = max(_sink->stats.latencyMax, _time);
+		}
+		else
+		{
+			fprintf(stderr, "sink: could not write to %s, output stopped\n", _sink->target);
+			_sink->stats.dropped += 1;
+			_sink->failed = true;
+		}
+	}
+	// frames left behind by a failed output or never read by anyone
+	if (_sink->pending >= 0)
+	{
+		_sink->stats.dropped += 1;
+		_sink->pending = -1;
+	}
+	CondBroadcast(_sink->cond);
+	MutexUnlock(_sink->mutex);
+}
+
+static bool SinkDescriptorSubmit(SINK *_base, const FRAMECOLOR *_pixels)
+{
+	SINKDESCRIPTOR *_sink = (SINKDESCRIPTOR*)_base;
+	double _time = MazeTime();
+	MutexLock(_sink->mutex);
+	_sink->stats.submitted += 1;
+	while (!_sink->drop && (_sink->pending >= 0) && !_sink->failed)
+		CondWait(_sink->cond, _sink->mutex);
+	if (_sink->failed)
+	{
+		_sink->stats.dropped += 1;
+		MutexUnlock(_sink->mutex);
+		return false;
+	}
+	// the free buffer is the pending one, taken back, or the one the writer does not hold
+	int _buffer = (_sink->writing == 0) ? 1 : 0;
+	if (_sink->pending >= 0)
+	{
+		_buffer = _sink->pending;
+		_sink->pending = -1;
+		_sink->stats.dropped += 1;
+	}
+	MutexUnlock(_sink->mutex);
+
+	SinkConvert(_base, _pixels, _sink->buffers[_buffer] + _sink->header);
+
+	MutexLock(_sink->mutex);
+	_sink->pending = _buffer;
+	_sink->pendingTime = _time;
+	CondBroadcast(_sink->cond);
+	MutexUnlock(_sink->mutex);
+	return true;
+}
+
+static void SinkDescriptorClose(SINK *_base, SINKSTATS *_stats)
+{
+	SINKDESCRIPTOR *_sink = (SINKDESCRIPTOR*)_base;
+	if (_sink->thread != NULL)
+	{
+		MutexLock(_sink->mutex);
+		_sink->quit = true;
+#ifndef _WIN32
+		_sink->released = !_sink->opened && _sink->fifo;
+#endif
+		CondBroadcast(_sink->cond);
+		MutexUnlock(_sink->mutex);
+#ifdef _WIN32
+		ThreadJoin(_sink->thread);
+#else
+		// a reader of our own releases a writer still waiting for the panel on a FIFO
+		int _reader = _sink->released ? open(_sink->target, O_RDONLY | O_NONBLOCK) : -1;
+		ThreadJoin(_sink->thread);
+		if (_reader >= 0)
+			close(_reader);
+#endif
+	}
+	*_stats = _sink->stats;
+#ifdef _WIN32
+	if (_sink->fd > 1)
+		_close(_sink->fd);
+#else
+	if (_sink->fd > 1)
+		close(_sink->fd);
+#endif
+	if (_sink->cond != NULL)
+		CondRemove(_sink->cond);
+	if (_sink->mutex != NULL)
+		MutexRemove(_sink->mutex);
+	free(_sink->buffers[0]);
+	free(_sink->buffers[1]);
+	free(_sink->target);
+	free(_sink);
+}
+
+SINK *SinkOpenDescriptor(const char *_target, int _format)
+{
+	SINKDESCRIPTOR *_sink = (SINKDESCRIPTOR*)calloc(1, sizeof(SINKDESCRIPTOR));
+	if (_sink == NULL)
+		return NULL;
+	_sink->sink.submit = SinkDescriptorSubmit;
+	_sink->sink.close = SinkDescriptorClose;
+	SinkLevels(&_sink->sink, 1.0f, 1.0f);
+	_sink->fd = -1;
+	_sink->pending = -1;
+	_sink->writing = -1;
+	_sink->socket = (strncmp(_target, SINK_UNIX, strlen(SINK_UNIX)) == 0);
+	_sink->drop = _sink->socket;
+#ifndef _WIN32
+	struct stat _info;
+	_sink->fifo = !_sink->socket && (stat(_target, &_info) == 0) && S_ISFIFO(_info.st_mode);
+	_sink->drop = _sink->socket || _sink->fifo;
+	if (_sink->drop)
+		signal(SIGPIPE, SIG_IGN); // a reader going away fails the write instead of ending the game
+#endif
+
+	char _header[32] = "";
+	if (_format == SINK_PPM)
+		snprintf(_header, sizeof(_header), "P6\n%i %i\n255\n", FRAME_WIDTH, FRAME_HEIGHT);
+	_sink->header = strlen(_header);
+	_sink->target = (char*)malloc(strlen(_target) + 1);
+	_sink->buffers[0] = (unsigned char*)malloc(_sink->header + SINK_RGB_BYTES);
+	_sink->buffers[1] = (unsigned char*)malloc(_sink->header + SINK_RGB_BYTES);
+	_sink->mutex = MutexCreate();
+	_sink->cond = CondCreate();
+	if ((_sink->target == NULL) || (_sink->buffers[0] == NULL) || (_sink->buffers[1] == NULL) || (_sink->mutex == NULL) || (_sink->cond == NULL))
+	{
+		SINKSTATS _stats;
+		SinkDescriptorClose(&_sink->sink, &_stats);
+		return NULL;
+	}
+	strcpy(_sink->target, _target);
+	memcpy(_sink->buffers[0], _header, _sink->header);
+	memcpy(_sink->buffers[1], _header, _sink->header);
+
+	_sink->thread = ThreadCreate(SinkDescriptorWriter, _sink);
+	if (_sink->thread == NULL)
+	{
+		SINKSTATS _stats;
+		SinkDescriptorClose(&_sink->sink, &_stats);
+		return NULL;
+	}
+	return &_sink->sink;
+}
@@ -0,0 +1,76 @@
+/**********************************************************************************************
+*
+*   sink - outputs of the finished 32x32 frames
+*
+*   A sink takes every finished frame and hands it to something outside the game: the LED
+*   panel controller, a file, another process. Sinks share a small interface of a submit and
+*   a close function, so the backend feeding them does not know what is behind.
+*
+*   The descriptor sink streams the frames to a file, the standard output, a FIFO or a Unix
+*   stream socket. It keeps two RGB buffers: a submitted frame is converted into the free
+*   one through a single table holding gamma and brightness, and a writer thread writes that
+*   same buffer to the descriptor, so the frame is never copied again and the game never
+*   waits for the output. On FIFOs and sockets, a frame still waiting for the writer when the
+*   next one arrives is dropped and replaced by it, as the panel only cares about the last
+*   frame. On files and the standard output every frame is written, the game waiting when
+*   the writer falls behind.
+*
+*   Sinks count the frames written and dropped, and the latency from the submission to the
+*   end of the write.
+*
+*   LICENSE: zlib/libpng
+*
+*   Copyright (c) 2020 Jose Miguel Rodriguez Chavarri (https://github.com/txesmi/)
+*
+**********************************************************************************************/
+
+#ifndef SINK_H
+#define SINK_H
+
+#include "frame.h"
+#include <stdbool.h>
+
+//--------------------------------------------------------------------------------------------
+// DEFINES
+//--------------------------------------------------------------------------------------------
+
+#define SINK_PIXELS               (FRAME_WIDTH * FRAME_HEIGHT)
+#define SINK_RGB_BYTES            (SINK_PIXELS * 3)
+#define SINK_UNIX                 "unix:" // prefix of the Unix socket paths
+
+enum SinkFormats
+{
+	SINK_RGB, // raw RGB bytes, row by row from the top
+	SINK_PPM // a binary PPM per frame
+};
+
+//--------------------------------------------------------------------------------------------
+// SINK
+//--------------------------------------------------------------------------------------------
+
+typedef struct
+{
+	long long submitted;
+	long long written;
+	long long dropped; // replaced by a newer frame, lost to a failed output or never read
+	double latency; // seconds from the submission to the end of the write, summed over the written frames
+	double latencyMax;
+} SINKSTATS;
+
+typedef struct SINK SINK;
+
+struct SINK
+{
+	bool (*submit)(SINK *_sink, const FRAMECOLOR *_pixels); // false when the frame is dropped
+	void (*close)(SINK *_sink, SINKSTATS *_stats); // flushes and frees the sink
+	unsigned char levels[256]; // channel values after gamma and brightness
+};
+
+void SinkLevels(SINK *_sink, float _gamma, float _brightness); // 1, 1 leaves the colors as they are
+bool SinkSubmit(SINK *_sink, const FRAMECOLOR *_pixels); // SINK_PIXELS pixels, only read during the call
+void SinkClose(SINK *_sink, SINKSTATS *_stats); // _stats may be NULL
+void SinkReport(const char *_name, const SINKSTATS *_stats); // a line on stderr
+
+SINK *SinkOpenDescriptor(const char *_target, int _format); // - for the standard output, SINK_UNIX and a path for a socket, NULL when out of memory
+
+#endif // SINK_H
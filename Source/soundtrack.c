@@ -0,0 +1,280 @@
+/**********************************************************************************************
+*
+*   soundtrack - the melodies of the game
+*
+*   LICENSE: zlib/libpng
+*
+*   Copyright (c) 2020 Jose Miguel Rodriguez Chavarri (https://github.com/txesmi/)
+*
+**********************************************************************************************/
+
+#include "soundtrack.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define max(a, b) ((a) > (b) ? (a) : (b))
+#define min(a, b) ((a) < (b) ? (a) : (b))
+
+// sizeof of an array of -1 chars fails the build, C99 has no static assertions
+#define SOUNDTRACK_CHECK(condition)         sizeof(char[(condition) ? 1 : -1])
+#define SOUNDTRACK_ASSERT(condition, name)  typedef char soundtrackAssert_##name[(condition) ? 1 : -1]
+
+// a note whose key, length or volume is out of range does not compile
+#define SOUNDTRACK_NOTE(type, key, length, volume) \
+	{ \
+		(unsigned char)(type), \
+		(unsigned char)((key) + 0 * SOUNDTRACK_CHECK(((type) != SYNTH_TONE) || (((key) >= MIDI_A0) && ((key) <= MIDI_C8)))), \
+		(unsigned char)((volume) + 0 * SOUNDTRACK_CHECK(((volume) >= 0) && ((volume) <= SOUNDTRACK_VOLUME_ONE))), \
+		(unsigned short)((length) + 0 * SOUNDTRACK_CHECK(((length) > 0) && ((length) <= 65535))) \
+	}
+#define TONE(key, length, volume)           SOUNDTRACK_NOTE(SYNTH_TONE, key, length, volume)
+#define NOISE(length, volume)               SOUNDTRACK_NOTE(SYNTH_NOISE, 0, length, volume)
+#define HIT(length, volume)                 SOUNDTRACK_NOTE(SYNTH_HIT, 0, length, volume)
+
+#define SOUNDTRACK_COUNT(notes)             ((int)(sizeof(notes) / sizeof((notes)[0])))
+#define SOUNDTRACK_PART(name, notes, loop, parent) \
+	{ name, notes, SOUNDTRACK_COUNT(notes), loop, parent }
+
+//--------------------------------------------------------------------------------------------
+// MELODIES
+//--------------------------------------------------------------------------------------------
+
+// lengths in thousandths and volumes in hundredths
+
+// measure 8:8
+const SOUNDTRACKNOTE melodyHighNotes[] =
+{
+	TONE(MIDI_C5, 2000, 0), // silence
+	TONE(MIDI_C5, 2000, 10),
+	TONE(MIDI_B4, 3000, 10),
+	TONE(MIDI_B4, 1000, 10),
+
+	TONE(MIDI_C5, 4000, 10),
+	TONE(MIDI_B4, 5000, 10),
+
+	TONE(MIDI_C5, 2000, 10), // 1:8 late
+	TONE(MIDI_B4, 3000, 10),
+	TONE(MIDI_B4, 1000, 10),
+	TONE(MIDI_C5, 1000, 10),
+
+	TONE(MIDI_G5, 2000, 10),
+	TONE(MIDI_C5, 1000, 10),
+	TONE(MIDI_B4, 7000, 10),
+
+	TONE(MIDI_C5, 2000, 10), // 2:8 late
+	TONE(MIDI_B4, 3000, 10),
+	TONE(MIDI_B4, 1000, 10),
+
+	TONE(MIDI_C5, 4000, 10),
+	TONE(MIDI_B4, 5000, 10),
+
+	TONE(MIDI_C5, 2000, 10), // 1:8 late
+	TONE(MIDI_B4, 3000, 10),
+	TONE(MIDI_B4, 1000, 10),
+	TONE(MIDI_C5, 1000, 10),
+
+	TONE(MIDI_G5, 2000, 10),
+	TONE(MIDI_C5, 1000, 10),
+	TONE(MIDI_B4, 4000, 10) // 7:8 syncope
+};
+
+const SOUNDTRACKNOTE melodyHighEndNotes[] =
+{
+	TONE(MIDI_G3, 500, 0), // silence
+	TONE(MIDI_G3, 500, 30),
+	TONE(MIDI_A3, 500, 30),
+	TONE(MIDI_B3, 500, 30),
+	TONE(MIDI_C4, 500, 30),
+	TONE(MIDI_B3, 500, 30),
+	TONE(MIDI_E4, 500, 30),
+	TONE(MIDI_G4, 500, 30),
+	TONE(MIDI_C5, 4000, 30)
+};
+
+const SOUNDTRACKNOTE melodyBassNotes[] =
+{
+	TONE(MIDI_A1, 1600, 70),
+	TONE(MIDI_E2, 1400, 70),
+	TONE(MIDI_A2, 1000, 50),
+
+	TONE(MIDI_A1, 1600, 70),
+	TONE(MIDI_E2, 1400, 70),
+	TONE(MIDI_A2, 1000, 50),
+
+	TONE(MIDI_B1, 1600, 70),
+	TONE(MIDI_F2, 1400, 70),
+	TONE(MIDI_B2, 1000, 50),
+
+	TONE(MIDI_F2, 1600, 70),
+	TONE(MIDI_B2, 1400, 70),
+	TONE(MIDI_E3, 1000, 50)
+};
+
+const SOUNDTRACKNOTE melodyBassEndNotes[] =
+{
+	TONE(MIDI_E1, 1600, 70),
+	TONE(MIDI_F1a, 1400, 50),
+	TONE(MIDI_G1, 1000, 50),
+	TONE(MIDI_A2, 4000, 70)
+};
+
+const SOUNDTRACKNOTE melodyClaveNotes[] =
+{
+	HIT(555, 10),
+	HIT(755, 7),
+	HIT(555, 15),
+	HIT(370, 7),
+	HIT(750, 10)
+};
+
+const SOUNDTRACKNOTE melodyClaveEndNotes[] =
+{
+	HIT(555, 10),
+	HIT(555, 7),
+	HIT(8755, 15)
+};
+
+const SOUNDTRACKNOTE melodyBonusNotes[] =
+{
+	TONE(MIDI_A4, 200, 30),
+	TONE(MIDI_B4, 200, 40),
+	TONE(MIDI_C5a, 1000, 50)
+};
+
+const SOUNDTRACKNOTE melodyOpenNotes[] =
+{
+	NOISE(2000, 25)
+};
+
+SOUNDTRACK_ASSERT(SOUNDTRACK_COUNT(melodyHighNotes) + SOUNDTRACK_COUNT(melodyHighEndNotes)
+	+ SOUNDTRACK_COUNT(melodyBassNotes) + SOUNDTRACK_COUNT(melodyBassEndNotes)
+	+ SOUNDTRACK_COUNT(melodyClaveNotes) + SOUNDTRACK_COUNT(melodyClaveEndNotes)
+	+ SOUNDTRACK_COUNT(melodyBonusNotes) + SOUNDTRACK_COUNT(melodyOpenNotes) <= SOUNDTRACK_NOTES, notes);
+
+const SOUNDTRACKPART SoundtrackParts[SOUNDTRACK_VOICES] =
+{
+	[VOICE_HIGH] = SOUNDTRACK_PART("high", melodyHighNotes, true, -1),
+	[VOICE_BASS] = SOUNDTRACK_PART("bass", melodyBassNotes, true, VOICE_HIGH),
+	[VOICE_CLAVE] = SOUNDTRACK_PART("clave", melodyClaveNotes, true, VOICE_BASS),
+	[VOICE_HIGH_END] = SOUNDTRACK_PART("highend", melodyHighEndNotes, false, -1),
+	[VOICE_BASS_END] = SOUNDTRACK_PART("bassend", melodyBassEndNotes, false, VOICE_HIGH_END),
+	[VOICE_CLAVE_END] = SOUNDTRACK_PART("claveend", melodyClaveEndNotes, false, VOICE_HIGH_END),
+	[VOICE_BONUS] = SOUNDTRACK_PART("bonus", melodyBonusNotes, false, -1),
+	[VOICE_OPEN] = SOUNDTRACK_PART("open", melodyOpenNotes, false, -1)
+};
+
+//--------------------------------------------------------------------------------------------
+// SOUNDTRACK
+//--------------------------------------------------------------------------------------------
+
+typedef struct
+{
+	int type; // SYNTH_TONE or SYNTH_NOISE
+	int midi;
+	int length;
+	int volume;
+	int offset; // into the arena
+	int count;
+} SOUNDTRACKWAVE;
+
+// the wave a note plays, hits are noise of SYNTH_HIT_LENGTH whatever their length
+static SOUNDTRACKWAVE SoundtrackWave(const SOUNDTRACKNOTE *_note)
+{
+	SOUNDTRACKWAVE _wave = { _note->type, _note->midi, _note->length, _note->volume, 0, 0 };
+	if (_wave.type != SYNTH_TONE)
+	{
+		if (_wave.type == SYNTH_HIT)
+			_wave.length = (int)(SYNTH_HIT_LENGTH * SOUNDTRACK_LENGTH_ONE);
+		_wave.type = SYNTH_NOISE;
+		_wave.midi = 0;
+	}
+	float _length = (float)_wave.length / (float)SOUNDTRACK_LENGTH_ONE;
+	_wave.count = (_wave.type == SYNTH_TONE) ? SynthToneSamples((float)SynthFrequency(_wave.midi), _length) : SynthNoiseSamples(_length);
+	return _wave;
+}
+
+bool SoundtrackCreate(SOUNDTRACK *_soundtrack, MIXER *_mixer)
+{
+	memset(_soundtrack, 0, sizeof(SOUNDTRACK));
+
+	// the waves of the notes, each one once, in the order they first play
+	SOUNDTRACKWAVE _waves[SOUNDTRACK_NOTES];
+	int _noteWaves[SOUNDTRACK_NOTES];
+	int _note = 0;
+	for (int _v = 0; _v < SOUNDTRACK_VOICES; _v += 1)
+	{
+		const SOUNDTRACKPART *_part = SoundtrackParts + _v;
+		for (int _n = 0; _n < _part->count; _n += 1, _note += 1)
+		{
+			SOUNDTRACKWAVE _wave = SoundtrackWave(_part->notes + _n);
+			int _w = 0;
+			while ((_w < _soundtrack->waves) && ((_waves[_w].type != _wave.type) || (_waves[_w].midi != _wave.midi)
+				|| (_waves[_w].length != _wave.length) || (_waves[_w].volume != _wave.volume)))
+				_w += 1;
+			if (_w == _soundtrack->waves)
+			{
+				_wave.offset = _soundtrack->samples;
+				_waves[_w] = _wave;
+				_soundtrack->waves += 1;
+				_soundtrack->samples += _wave.count;
+			}
+			_noteWaves[_note] = _w;
+		}
+	}
+
+	_soundtrack->arena = (short*)malloc((size_t)max(_soundtrack->samples, 1) * sizeof(short));
+	if (_soundtrack->arena == NULL)
+		return false;
+	for (int _w = 0; _w < _soundtrack->waves; _w += 1)
+	{
+		const SOUNDTRACKWAVE *_wave = _waves + _w;
+		float _volume = (float)_wave->volume / (float)SOUNDTRACK_VOLUME_ONE;
+		if (_wave->type == SYNTH_TONE)
+			SynthTone(_soundtrack->arena + _wave->offset, _wave->count, (float)SynthFrequency(_wave->midi), _volume);
+		else
+			SynthNoise(_soundtrack->arena + _wave->offset, _wave->count, _volume);
+	}
+
+	_note = 0;
+	for (int _v = 0; _v < SOUNDTRACK_VOICES; _v += 1)
+	{
+		const SOUNDTRACKPART *_part = SoundtrackParts + _v;
+		MELODY *_melody = _soundtrack->melodies + _v;
+		_melody->notes = _soundtrack->notes + _note;
+		_melody->count = _part->count;
+		_melody->voice = _v;
+		float _carry = 0; // notes start on the nearest sample to their time
+		for (int _n = 0; _n < _part->count; _n += 1, _note += 1)
+		{
+			const SOUNDTRACKNOTE *_source = _part->notes + _n;
+			const SOUNDTRACKWAVE *_wave = _waves + _noteWaves[_note];
+			MIXERNOTE *_mixerNote = _soundtrack->notes + _note;
+			_mixerNote->wave = _soundtrack->arena + _wave->offset;
+			_mixerNote->samples = _wave->count;
+			_mixerNote->duration = MixerDuration(SynthDuration(_source->type, (float)_source->length / (float)SOUNDTRACK_LENGTH_ONE, _wave->count), SYNTH_SAMPLE_RATE, &_carry);
+		}
+		MixerSet(_mixer, _v, _melody->notes, _melody->count, _part->loop);
+		MixerFollow(_mixer, _v, _part->parent);
+	}
+	return true;
+}
+
+void SoundtrackRemove(SOUNDTRACK *_soundtrack, MIXER *_mixer)
+{
+	if (_soundtrack->arena == NULL)
+		return;
+	for (int _v = 0; _v < SOUNDTRACK_VOICES; _v += 1)
+		MixerSet(_mixer, _v, NULL, 0, false);
+	free(_soundtrack->arena);
+	_soundtrack->arena = NULL;
+}
+
+int SoundtrackVoice(const char *_name)
+{
+	for (int _v = 0; _v < SOUNDTRACK_VOICES; _v += 1)
+	{
+		if (strcmp(SoundtrackParts[_v].name, _name) == 0)
+			return _v;
+	}
+	return -1;
+}
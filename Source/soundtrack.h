@@ -0,0 +1,188 @@
+/**********************************************************************************************
+*
+*   soundtrack - the melodies of the game
+*
+*   Every melody is a table of notes built at compile time: the initializer macros check the
+*   type, key, length and volume of each note and the size of every table, so a bad note
+*   fails the build instead of the game. A melody plays on a voice of its own of a mixer and
+*   the parts of a song follow the voice leading it, so they start over together.
+*
+*   A soundtrack holds the notes of every melody in a single array and the samples of every
+*   wave in a single arena: notes with the same wave are found while the arena is sized, so
+*   each wave is synthesized once, and the whole soundtrack takes one allocation and one free.
+*
+*   Nothing here depends on raylib: the game feeds its audio stream with the mixer, and the
+*   same melodies render offline to WAV files on machines without an audio device.
+*
+*   LICENSE: zlib/libpng
+*
+*   Copyright (c) 2020 Jose Miguel Rodriguez Chavarri (https://github.com/txesmi/)
+*
+**********************************************************************************************/
+
+#ifndef SOUNDTRACK_H
+#define SOUNDTRACK_H
+
+#include "mixer.h"
+#include "synth.h"
+
+//--------------------------------------------------------------------------------------------
+// DEFINES
+//--------------------------------------------------------------------------------------------
+
+#define SOUNDTRACK_NOTES          64 // of every melody together
+#define SOUNDTRACK_LENGTH_ONE     1000 // a length of 1 for the synth
+#define SOUNDTRACK_VOLUME_ONE     100
+
+enum MelodyVoices
+{
+	VOICE_HIGH,
+	VOICE_BASS, // follows the high line
+	VOICE_CLAVE, // follows the bass
+	VOICE_HIGH_END,
+	VOICE_BASS_END, // follows the high end
+	VOICE_CLAVE_END, // follows the high end
+	VOICE_BONUS,
+	VOICE_OPEN,
+	SOUNDTRACK_VOICES
+};
+
+enum MidiKeys {
+	MIDI_A0 = 21,
+	MIDI_A0a,
+	MIDI_B0,
+	MIDI_C1 = 24,
+	MIDI_C1a,
+	MIDI_D1,
+	MIDI_D1a,
+	MIDI_E1,
+	MIDI_F1,
+	MIDI_F1a,
+	MIDI_G1,
+	MIDI_G1a,
+	MIDI_A1,
+	MIDI_A1a,
+	MIDI_B1,
+	MIDI_C2 = 36,
+	MIDI_C2a,
+	MIDI_D2,
+	MIDI_D2a,
+	MIDI_E2,
+	MIDI_F2,
+	MIDI_F2a,
+	MIDI_G2,
+	MIDI_G2a,
+	MIDI_A2,
+	MIDI_A2a,
+	MIDI_B2,
+	MIDI_C3 = 48,
+	MIDI_C3a,
+	MIDI_D3,
+	MIDI_D3a,
+	MIDI_E3,
+	MIDI_F3,
+	MIDI_F3a,
+	MIDI_G3,
+	MIDI_G3a,
+	MIDI_A3,
+	MIDI_A3a,
+	MIDI_B3,
+	MIDI_C4 = 60,
+	MIDI_C4a,
+	MIDI_D4,
+	MIDI_D4a,
+	MIDI_E4,
+	MIDI_F4,
+	MIDI_F4a,
+	MIDI_G4,
+	MIDI_G4a,
+	MIDI_A4,
+	MIDI_A4a,
+	MIDI_B4,
+	MIDI_C5 = 72,
+	MIDI_C5a,
+	MIDI_D5,
+	MIDI_D5a,
+	MIDI_E5,
+	MIDI_F5,
+	MIDI_F5a,
+	MIDI_G5,
+	MIDI_G5a,
+	MIDI_A5,
+	MIDI_A5a,
+	MIDI_B5,
+	MIDI_C6 = 84,
+	MIDI_C6a,
+	MIDI_D6,
+	MIDI_D6a,
+	MIDI_E6,
+	MIDI_F6,
+	MIDI_F6a,
+	MIDI_G6,
+	MIDI_G6a,
+	MIDI_A6,
+	MIDI_A6a,
+	MIDI_B6,
+	MIDI_C7 = 96,
+	MIDI_C7a,
+	MIDI_D7,
+	MIDI_D7a,
+	MIDI_E7,
+	MIDI_F7,
+	MIDI_F7a,
+	MIDI_G7,
+	MIDI_G7a,
+	MIDI_A7,
+	MIDI_A7a,
+	MIDI_B7,
+	MIDI_C8 = 108
+};
+
+//--------------------------------------------------------------------------------------------
+// MELODY
+//--------------------------------------------------------------------------------------------
+
+typedef struct
+{
+	unsigned char type; // SYNTH_TONE, SYNTH_NOISE or SYNTH_HIT
+	unsigned char midi; // 0 for noise
+	unsigned char volume; // SOUNDTRACK_VOLUME_ONE for 1
+	unsigned short length; // SOUNDTRACK_LENGTH_ONE for 1
+} SOUNDTRACKNOTE;
+
+typedef struct
+{
+	const MIXERNOTE *notes; // in the soundtrack
+	int count;
+	int voice;
+} MELODY;
+
+//--------------------------------------------------------------------------------------------
+// SOUNDTRACK
+//--------------------------------------------------------------------------------------------
+
+typedef struct
+{
+	const char *name;
+	const SOUNDTRACKNOTE *notes;
+	int count;
+	bool loop;
+	int parent; // voice it follows, -1 for none
+} SOUNDTRACKPART;
+
+typedef struct
+{
+	short *arena; // samples of every wave
+	int samples;
+	int waves;
+	MIXERNOTE notes[SOUNDTRACK_NOTES]; // the melodies one after the other
+	MELODY melodies[SOUNDTRACK_VOICES]; // by voice
+} SOUNDTRACK;
+
+extern const SOUNDTRACKPART SoundtrackParts[SOUNDTRACK_VOICES]; // by voice
+
+bool SoundtrackCreate(SOUNDTRACK *_soundtrack, MIXER *_mixer); // every part on its voice, false when out of memory
+void SoundtrackRemove(SOUNDTRACK *_soundtrack, MIXER *_mixer);
+int SoundtrackVoice(const char *_name); // voice of the part, -1 when there is none by that name
+
+#endif // SOUNDTRACK_H
@@ -0,0 +1,98 @@
+/**********************************************************************************************
+*
+*   synth - note synthesis
+*
+*   LICENSE: zlib/libpng
+*
+*   Copyright (c) 2020 Jose Miguel Rodriguez Chavarri (https://github.com/txesmi/)
+*
+**********************************************************************************************/
+
+#include "synth.h"
+#include <math.h>
+
+#define max(a, b) ((a) > (b) ? (a) : (b))
+#define min(a, b) ((a) < (b) ? (a) : (b))
+
+#define SYNTH_PI                  3.14159265358979323846
+#define SYNTH_LENGTH_SCALE        ((float)SYNTH_SAMPLE_RATE / 11025.0f) // lengths were tuned at 11025 Hz
+#define SYNTH_TONE_ATTACK         256.0f // amplitude gained per sample
+#define SYNTH_TONE_PEAK           (25000.0f / 4.0f)
+#define SYNTH_NOISE_PEAK          25000
+
+//--------------------------------------------------------------------------------------------
+// SYNTH
+//--------------------------------------------------------------------------------------------
+
+typedef struct
+{
+	float table[SYNTH_TABLE]; // a cycle of the fundamental and its two upper octaves
+	GENERATOR noise;
+} SYNTH;
+
+static SYNTH gSynth;
+
+void SynthInit(const GENERATOR *_noise)
+{
+	for (int _i = 0; _i < SYNTH_TABLE; _i += 1)
+	{
+		double _angle = 2.0 * SYNTH_PI * (double)_i / (double)SYNTH_TABLE;
+		gSynth.table[_i] = (float)(sin(_angle) + 0.5 * sin(2.0 * _angle) + 0.25 * sin(4.0 * _angle));
+	}
+	gSynth.noise = *_noise;
+}
+
+double SynthFrequency(int _midi)
+{
+	return 440.0 * pow(2.0, ((double)_midi - 69.0) / 12.0);
+}
+
+int SynthToneSamples(float _frequency, float _length)
+{
+	int _cycle = (int)((float)SYNTH_SAMPLE_RATE / _frequency);
+	int _cycles = (int)(min((float)SYNTH_SAMPLES_MAX, (float)SYNTH_SAMPLES_MAX * _length * SYNTH_LENGTH_SCALE) / _cycle);
+	return _cycle * _cycles;
+}
+
+int SynthNoiseSamples(float _length)
+{
+	return (int)min((float)SYNTH_SAMPLES_MAX, (float)SYNTH_SAMPLES_MAX * _length * SYNTH_LENGTH_SCALE);
+}
+
+float SynthDuration(int _type, float _length, int _samples)
+{
+	switch (_type)
+	{
+	case SYNTH_TONE: return (float)SYNTH_SAMPLES_MAX * _length * SYNTH_LENGTH_SCALE / (float)SYNTH_SAMPLE_RATE;
+	case SYNTH_HIT: return _length;
+	default: return (float)_samples / (float)SYNTH_SAMPLE_RATE;
+	}
+}
+
+void SynthTone(short *_wave, int _samples, float _frequency, float _volume)
+{
+	float _mix[SYNTH_SAMPLES_MAX];
+	// the phase wraps at 2^32 every cycle of whole samples, a cycle of one sample steps 2^32 that wraps to 0
+	unsigned int _phase = 0;
+	unsigned int _step = (unsigned int)((1ull << 32) / (unsigned long long)(int)((float)SYNTH_SAMPLE_RATE / _frequency));
+	for (int _s = 0; _s < _samples; _s += 1, _phase += _step)
+		_mix[_s] = gSynth.table[_phase >> (32 - SYNTH_TABLE_BITS)];
+
+	// attack and decay
+	float _decay = 1.0f / (float)_samples;
+	for (int _s = 0; _s < _samples; _s += 1)
+	{
+		float _amplitude = min((float)_s * SYNTH_TONE_ATTACK, SYNTH_TONE_PEAK) * (float)(_samples - _s) * _decay;
+		_wave[_s] = (short)(_mix[_s] * _amplitude * _volume);
+	}
+}
+
+void SynthNoise(short *_wave, int _samples, float _volume)
+{
+	for (int _s = 0; _s < _samples; _s += 1)
+	{
+		int _amplitude = min(_s * 256, SYNTH_NOISE_PEAK); // attack
+		_amplitude = (int)((float)_amplitude * (float)(_samples - _s) / (float)_samples); // decay
+		_wave[_s] = (short)((float)GeneratorRandom(&gSynth.noise, -_amplitude, _amplitude) * _volume);
+	}
+}
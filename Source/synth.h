@@ -0,0 +1,53 @@
+/**********************************************************************************************
+*
+*   synth - note synthesis
+*
+*   Tones read a single cycle of the fundamental and its two upper octaves from a wavetable,
+*   stepping a fixed point phase accumulator, so a sample costs a table read instead of three
+*   sines. The envelope is applied in a second pass over the whole note, a plain loop over
+*   floats the compiler can vectorize.
+*
+*   Samples are signed 16 bits, mono, at SYNTH_SAMPLE_RATE.
+*
+*   LICENSE: zlib/libpng
+*
+*   Copyright (c) 2020 Jose Miguel Rodriguez Chavarri (https://github.com/txesmi/)
+*
+**********************************************************************************************/
+
+#ifndef SYNTH_H
+#define SYNTH_H
+
+#include "maze.h"
+
+//--------------------------------------------------------------------------------------------
+// DEFINES
+//--------------------------------------------------------------------------------------------
+
+#define SYNTH_SAMPLE_RATE         8000
+#define SYNTH_SAMPLES_MAX         4096 // longest wave
+#define SYNTH_TABLE_BITS          12
+#define SYNTH_TABLE               (1 << SYNTH_TABLE_BITS) // wavetable entries for a cycle
+#define SYNTH_HIT_LENGTH          0.125f // length of the noise of a hit
+
+enum SynthTypes
+{
+	SYNTH_TONE = 1,
+	SYNTH_NOISE,
+	SYNTH_HIT // noise of SYNTH_HIT_LENGTH lasting the length of the note
+};
+
+//--------------------------------------------------------------------------------------------
+// SYNTH
+//--------------------------------------------------------------------------------------------
+
+void SynthInit(const GENERATOR *_noise); // builds the wavetable, the noise takes its own copy of the generator
+
+double SynthFrequency(int _midi);
+int SynthToneSamples(float _frequency, float _length); // whole cycles, at most SYNTH_SAMPLES_MAX
+int SynthNoiseSamples(float _length);
+float SynthDuration(int _type, float _length, int _samples); // seconds until the next note
+void SynthTone(short *_wave, int _samples, float _frequency, float _volume); // _samples at most SYNTH_SAMPLES_MAX
+void SynthNoise(short *_wave, int _samples, float _volume); // not thread safe, draws from the generator of the synth
+
+#endif // SYNTH_H
@@ -0,0 +1,254 @@
+/**********************************************************************************************
+*
+*   thread - portable threads, locks and atomics
+*
+*   LICENSE: zlib/libpng
+*
+*   Copyright (c) 2020 Jose Miguel Rodriguez Chavarri (https://github.com/txesmi/)
+*
+**********************************************************************************************/
+
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200112L // pthreads, sysconf, nanosleep
+#endif
+
+#include "thread.h"
+#include <stdlib.h>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+//--------------------------------------------------------------------------------------------
+// THREAD
+//--------------------------------------------------------------------------------------------
+
+struct THREAD
+{
+#ifdef _WIN32
+	HANDLE handle;
+#else
+	pthread_t handle;
+#endif
+	THREADFUNC func;
+	void *data;
+};
+
+#ifdef _WIN32
+static DWORD WINAPI ThreadEntry(LPVOID _param)
+{
+	THREAD *_thread = (THREAD*)_param;
+	_thread->func(_thread->data);
+	return 0;
+}
+#else
+static void *ThreadEntry(void *_param)
+{
+	THREAD *_thread = (THREAD*)_param;
+	_thread->func(_thread->data);
+	return NULL;
+}
+#endif
+
+THREAD *ThreadCreate(THREADFUNC _func, void *_data)
+{
+	THREAD *_thread = (THREAD*)malloc(sizeof(THREAD));
+	if (_thread == NULL)
+		return NULL;
+	_thread->func = _func;
+	_thread->data = _data;
+
+#ifdef _WIN32
+	_thread->handle = CreateThread(NULL, 0, ThreadEntry, _thread, 0, NULL);
+	if (_thread->handle == NULL)
+#else
+	if (pthread_create(&_thread->handle, NULL, ThreadEntry, _thread) != 0)
+#endif
+	{
+		free(_thread);
+		return NULL;
+	}
+
+	return _thread;
+}
+
+void ThreadJoin(THREAD *_thread)
+{
+#ifdef _WIN32
+	WaitForSingleObject(_thread->handle, INFINITE);
+	CloseHandle(_thread->handle);
+#else
+	pthread_join(_thread->handle, NULL);
+#endif
+	free(_thread);
+}
+
+int ThreadHardwareCount(void)
+{
+#ifdef _WIN32
+	SYSTEM_INFO _info;
+	GetSystemInfo(&_info);
+	return _info.dwNumberOfProcessors > 0 ? (int)_info.dwNumberOfProcessors : 1;
+#else
+	long _count = sysconf(_SC_NPROCESSORS_ONLN);
+	return _count > 0 ? (int)_count : 1;
+#endif
+}
+
+void ThreadSleep(int _milliseconds)
+{
+#ifdef _WIN32
+	Sleep((DWORD)_milliseconds);
+#else
+	struct timespec _time = { _milliseconds / 1000, (long)(_milliseconds % 1000) * 1000000L };
+	while ((nanosleep(&_time, &_time) != 0) && (errno == EINTR))
+		;
+#endif
+}
+
+//--------------------------------------------------------------------------------------------
+// MUTEX
+//--------------------------------------------------------------------------------------------
+
+struct MUTEX
+{
+#ifdef _WIN32
+	CRITICAL_SECTION section;
+#else
+	pthread_mutex_t mutex;
+#endif
+};
+
+struct COND
+{
+#ifdef _WIN32
+	CONDITION_VARIABLE cond;
+#else
+	pthread_cond_t cond;
+#endif
+};
+
+MUTEX *MutexCreate(void)
+{
+	MUTEX *_mutex = (MUTEX*)malloc(sizeof(MUTEX));
+	if (_mutex == NULL)
+		return NULL;
+#ifdef _WIN32
+	InitializeCriticalSection(&_mutex->section);
+#else
+	if (pthread_mutex_init(&_mutex->mutex, NULL) != 0)
+	{
+		free(_mutex);
+		return NULL;
+	}
+#endif
+	return _mutex;
+}
+
+void MutexRemove(MUTEX *_mutex)
+{
+#ifdef _WIN32
+	DeleteCriticalSection(&_mutex->section);
+#else
+	pthread_mutex_destroy(&_mutex->mutex);
+#endif
+	free(_mutex);
+}
+
+void MutexLock(MUTEX *_mutex)
+{
+#ifdef _WIN32
+	EnterCriticalSection(&_mutex->section);
+#else
+	pthread_mutex_lock(&_mutex->mutex);
+#endif
+}
+
+void MutexUnlock(MUTEX *_mutex)
+{
+#ifdef _WIN32
+	LeaveCriticalSection(&_mutex->section);
+#else
+	pthread_mutex_unlock(&_mutex->mutex);
+#endif
+}
+
+COND *CondCreate(void)
+{
+	COND *_cond = (COND*)malloc(sizeof(COND));
+	if (_cond == NULL)
+		return NULL;
+#ifdef _WIN32
+	InitializeConditionVariable(&_cond->cond);
+#else
+	if (pthread_cond_init(&_cond->cond, NULL) != 0)
+	{
+		free(_cond);
+		return NULL;
+	}
+#endif
+	return _cond;
+}
+
+void CondRemove(COND *_cond)
+{
+#ifndef _WIN32
+	pthread_cond_destroy(&_cond->cond);
+#endif
+	free(_cond);
+}
+
+void CondWait(COND *_cond, MUTEX *_mutex)
+{
+#ifdef _WIN32
+	SleepConditionVariableCS(&_cond->cond, &_mutex->section, INFINITE);
+#else
+	pthread_cond_wait(&_cond->cond, &_mutex->mutex);
+#endif
+}
+
+void CondBroadcast(COND *_cond)
+{
+#ifdef _WIN32
+	WakeAllConditionVariable(&_cond->cond);
+#else
+	pthread_cond_broadcast(&_cond->cond);
+#endif
+}
+
+//--------------------------------------------------------------------------------------------
+// ATOMIC
+//--------------------------------------------------------------------------------------------
+
+int AtomicAdd(volatile int *_value, int _add)
+{
+#ifdef _MSC_VER
+	return (int)InterlockedExchangeAdd((volatile LONG*)_value, (LONG)_add);
+#else
+	return __atomic_fetch_add(_value, _add, __ATOMIC_SEQ_CST);
+#endif
+}
+
+int AtomicLoad(volatile int *_value)
+{
+#ifdef _MSC_VER
+	return (int)InterlockedCompareExchange((volatile LONG*)_value, 0, 0);
+#else
+	return __atomic_load_n(_value, __ATOMIC_SEQ_CST);
+#endif
+}
+
+void AtomicStore(volatile int *_value, int _store)
+{
+#ifdef _MSC_VER
+	InterlockedExchange((volatile LONG*)_value, (LONG)_store);
+#else
+	__atomic_store_n(_value, _store, __ATOMIC_SEQ_CST);
+#endif
+}
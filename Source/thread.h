@@ -0,0 +1,55 @@
+/**********************************************************************************************
+*
+*   thread - portable threads, locks and atomics
+*
+*   Thin layer over pthreads or the Win32 API, so the maze core can spread work over the
+*   cores without depending on a C11 threads implementation.
+*
+*   LICENSE: zlib/libpng
+*
+*   Copyright (c) 2020 Jose Miguel Rodriguez Chavarri (https://github.com/txesmi/)
+*
+**********************************************************************************************/
+
+#ifndef THREAD_H
+#define THREAD_H
+
+//--------------------------------------------------------------------------------------------
+// THREAD
+//--------------------------------------------------------------------------------------------
+
+typedef struct THREAD THREAD;
+
+typedef void (*THREADFUNC)(void *_data);
+
+THREAD *ThreadCreate(THREADFUNC _func, void *_data); // NULL when the thread can not be started
+void ThreadJoin(THREAD *_thread); // waits for the end of the thread and frees it
+int ThreadHardwareCount(void); // logical cores, at least 1
+void ThreadSleep(int _milliseconds);
+
+//--------------------------------------------------------------------------------------------
+// MUTEX
+//--------------------------------------------------------------------------------------------
+
+typedef struct MUTEX MUTEX;
+typedef struct COND COND;
+
+MUTEX *MutexCreate(void); // NULL when out of memory
+void MutexRemove(MUTEX *_mutex);
+void MutexLock(MUTEX *_mutex);
+void MutexUnlock(MUTEX *_mutex);
+
+COND *CondCreate(void); // NULL when out of memory
+void CondRemove(COND *_cond);
+void CondWait(COND *_cond, MUTEX *_mutex); // _mutex locked by the caller, may wake up spuriously
+void CondBroadcast(COND *_cond);
+
+//--------------------------------------------------------------------------------------------
+// ATOMIC
+//--------------------------------------------------------------------------------------------
+
+int AtomicAdd(volatile int *_value, int _add); // returns the previous value
+int AtomicLoad(volatile int *_value);
+void AtomicStore(volatile int *_value, int _store);
+
+#endif // THREAD_H
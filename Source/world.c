@@ -0,0 +1,285 @@
+/**********************************************************************************************
+*
+*   world - endless maze made of chunks
+*
+*   LICENSE: zlib/libpng
+*
+*   Copyright (c) 2020 Jose Miguel Rodriguez Chavarri (https://github.com/txesmi/)
+*
+**********************************************************************************************/
+
+#include "world.h"
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define max(a, b) ((a) > (b) ? (a) : (b))
+#define min(a, b) ((a) < (b) ? (a) : (b))
+
+#define WORLD_SIDE          (WORLD_CHUNK * WORLD_WINDOW + 1) // window cells per side
+#define WORLD_CENTER        (WORLD_CHUNK * (WORLD_WINDOW / 2)) // first window column and row of the central chunk
+#define WORLD_SEAM_SLOTS    ((WORLD_CHUNK - 4) / 2 / WORLD_SEAM_OPENINGS) // odd positions of a seam segment, 3 cells away from the corners
+
+enum WorldSalts
+{
+	WORLD_SALT_CHUNK,
+	WORLD_SALT_COLUMN, // seam on the left border of a chunk
+	WORLD_SALT_ROW, // seam on the top border of a chunk
+	WORLD_SALT_BUCKET
+};
+
+// the visibility flood never spreads from the window border while the viewer stays in the
+// central chunk, so the window border needs no walls of its own
+typedef char WorldReachCheck[(WORLD_CENTER > MAZE_VISIBILITY_MAX - MAZE_VISIBILITY_END + 1) ? 1 : -1];
+
+// every seam opening takes 16 bits of the seam hash
+typedef char WorldSeamCheck[(WORLD_SEAM_OPENINGS <= 4) && (WORLD_SEAM_SLOTS > 0) ? 1 : -1];
+
+//--------------------------------------------------------------------------------------------
+// CHUNKS
+//--------------------------------------------------------------------------------------------
+
+// splitmix64 finalizer over the seed and the coordinates
+static unsigned long long WorldHash(unsigned long long _seed, int _x, int _y, int _salt)
+{
+	unsigned long long _h = _seed;
+	_h ^= (unsigned long long)(unsigned int)_x * 0x9E3779B97F4A7C15ull;
+	_h ^= (unsigned long long)(unsigned int)_y * 0xC2B2AE3D27D4EB4Full;
+	_h ^= (unsigned long long)_salt * 0x165667B19E3779F9ull;
+	_h = (_h ^ (_h >> 30)) * 0xBF58476D1CE4E5B9ull;
+	_h = (_h ^ (_h >> 27)) * 0x94D049BB133111EBull;
+	return _h ^ (_h >> 31);
+}
+
+static WORLDCHUNK **WorldBucket(WORLD *_world, int _x, int _y)
+{
+	return _world->buckets + (WorldHash(0, _x, _y, WORLD_SALT_BUCKET) & (unsigned long long)_world->bucketMask);
+}
+
+static void WorldUnlink(WORLD *_world, WORLDCHUNK *_chunk)
+{
+	WORLDCHUNK **_link = WorldBucket(_world, _chunk->x, _chunk->y);
+	while (*_link != _chunk)
+		_link = &(*_link)->next;
+	*_link = _chunk->next;
+}
+
+// opens the passages of a seam from the border cell to the first odd cell inside, which
+// the carve always reaches, whatever the border cells beside it turned into
+static void WorldSeam(WORLD *_world, GRID *_grid, int _x, int _y, int _salt, int _border)
+{
+	unsigned long long _hash = WorldHash(_world->seed, _x, _y, _salt);
+	int _step = (_border == 0) ? 1 : -1;
+	for (int _i = 0; _i < WORLD_SEAM_OPENINGS; _i += 1, _hash >>= 16)
+	{
+		int _t = 3 + 2 * (_i * WORLD_SEAM_SLOTS + (int)((_hash & 0xFFFF) % WORLD_SEAM_SLOTS));
+		for (int _d = 0; _d < 3; _d += 1)
+		{
+			int _a = _border + _d * _step;
+			int _cell = (_salt == WORLD_SALT_COLUMN) ? GETCELL(_grid, _a, _t) : GETCELL(_grid, _t, _a);
+			if (_grid->types[_cell] <= CT_WALL)
+				_grid->types[_cell] = CT_OPEN;
+		}
+	}
+}
+
+static void WorldChunkBuild(WORLD *_world, WORLDCHUNK *_chunk)
+{
+	GRID *_grid = _chunk->grid;
+	GENERATOR _gen;
+	GeneratorInit(&_gen, WorldHash(_world->seed, _chunk->x, _chunk->y, WORLD_SALT_CHUNK));
+	_gen.bonusMin = WORLD_BONUS_MIN;
+	int _cellStart = GridMaze(&_gen, _grid);
+
+	// the world has no end and a single start
+	for (int _cell = 0; _cell < _grid->size; _cell += 1)
+	{
+		if (_grid->types[_cell] == CT_END)
+			_grid->types[_cell] = CT_OPEN;
+	}
+	if ((_chunk->x == 0) && (_chunk->y == 0))
+		_world->start = _cellStart;
+	else
+		_grid->types[_cellStart] = CT_OPEN;
+
+	WorldSeam(_world, _grid, _chunk->x, _chunk->y, WORLD_SALT_COLUMN, 0);
+	WorldSeam(_world, _grid, _chunk->x + 1, _chunk->y, WORLD_SALT_COLUMN, WORLD_CHUNK);
+	WorldSeam(_world, _grid, _chunk->x, _chunk->y, WORLD_SALT_ROW, 0);
+	WorldSeam(_world, _grid, _chunk->x, _chunk->y + 1, WORLD_SALT_ROW, WORLD_CHUNK);
+
+	_world->generated += 1;
+}
+
+// the chunk at the coordinates, generated into a free grid while the budget lasts or into
+// the least recently used one out of the window otherwise
+static WORLDCHUNK *WorldChunk(WORLD *_world, int _x, int _y)
+{
+	WORLDCHUNK **_bucket = WorldBucket(_world, _x, _y);
+	WORLDCHUNK *_chunk = *_bucket;
+	while ((_chunk != NULL) && ((_chunk->x != _x) || (_chunk->y != _y)))
+		_chunk = _chunk->next;
+
+	if (_chunk == NULL)
+	{
+		// a window never holds more chunks than the ones created with the world
+		for (int _i = 0; _i < _world->chunkCount; _i += 1)
+		{
+			WORLDCHUNK *_chunkT = _world->chunks + _i;
+			if ((_chunkT->used != _world->tick) && ((_chunk == NULL) || (_chunkT->used < _chunk->used)))
+				_chunk = _chunkT;
+		}
+
+		if ((_chunk->used != 0) && (_world->chunkCount < _world->chunkMax))
+		{
+			GRID *_grid = GridCreate(WORLD_CHUNK + 1, WORLD_CHUNK + 1);
+			if (_grid != NULL)
+			{
+				_chunk = _world->chunks + _world->chunkCount;
+				_chunk->grid = _grid;
+				_world->chunkCount += 1;
+			}
+			else
+				_world->chunkMax = _world->chunkCount; // less memory left than the budget
+		}
+
+		if (_chunk->used != 0) // chunks never used are not linked
+		{
+			WorldUnlink(_world, _chunk);
+			_world->evicted += 1;
+		}
+
+		_chunk->x = _x;
+		_chunk->y = _y;
+		_chunk->next = *_bucket;
+		*_bucket = _chunk;
+		WorldChunkBuild(_world, _chunk);
+	}
+
+	_chunk->used = _world->tick;
+	return _chunk;
+}
+
+//--------------------------------------------------------------------------------------------
+// WINDOW
+//--------------------------------------------------------------------------------------------
+
+// copies the window back to its chunks, the borders shared by two chunks go to both
+static void WorldStore(WORLD *_world)
+{
+	GRID *_window = _world->window;
+	for (int _i = 0; _i < WORLD_WINDOW * WORLD_WINDOW; _i += 1)
+	{
+		GRID *_grid = _world->windowChunks[_i]->grid;
+		int _cellW = GETCELL(_window, (_i % WORLD_WINDOW) * WORLD_CHUNK, (_i / WORLD_WINDOW) * WORLD_CHUNK);
+		for (int _cell = 0; _cell < _grid->size; _cell += _grid->width, _cellW += _window->width)
+		{
+			memcpy(_grid->types + _cell, _window->types + _cellW, (size_t)_grid->width);
+			memcpy(_grid->depths + _cell, _window->depths + _cellW, (size_t)_grid->width);
+		}
+	}
+}
+
+static void WorldCompose(WORLD *_world, int _x, int _y)
+{
+	GRID *_window = _world->window;
+	_world->tick += 1;
+	_world->windowX = _x;
+	_world->windowY = _y;
+
+	for (int _i = 0; _i < WORLD_WINDOW * WORLD_WINDOW; _i += 1)
+	{
+		WORLDCHUNK *_chunk = WorldChunk(_world, _x + _i % WORLD_WINDOW - WORLD_WINDOW / 2, _y + _i / WORLD_WINDOW - WORLD_WINDOW / 2);
+		_world->windowChunks[_i] = _chunk;
+		GRID *_grid = _chunk->grid;
+		int _cellW = GETCELL(_window, (_i % WORLD_WINDOW) * WORLD_CHUNK, (_i / WORLD_WINDOW) * WORLD_CHUNK);
+		for (int _cell = 0; _cell < _grid->size; _cell += _grid->width, _cellW += _window->width)
+		{
+			memcpy(_window->types + _cellW, _grid->types + _cell, (size_t)_grid->width);
+			memcpy(_window->depths + _cellW, _grid->depths + _cell, (size_t)_grid->width);
+		}
+	}
+
+	// the chunks knew nothing about the cells beyond their borders
+	GridMasks(_window);
+
+	// the cells moved, the next flood starts a new generation from scratch
+	memset(_window->stamps, 0, (size_t)_window->size * sizeof(unsigned short));
+	_window->stamp = 0;
+}
+
+//--------------------------------------------------------------------------------------------
+// WORLD
+//--------------------------------------------------------------------------------------------
+
+WORLD *WorldCreate(unsigned long long _seed, int _budgetMB)
+{
+	WORLD *_world = (WORLD*)calloc(1, sizeof(WORLD));
+	if (_world == NULL)
+		return NULL;
+	_world->seed = _seed;
+
+	// the window and the chunks of a window are always there, the budget adds chunks kept
+	// out of the window
+	long long _budget = (long long)max(_budgetMB, 0) * 1024 * 1024 - (long long)GridBytes(WORLD_SIDE, WORLD_SIDE);
+	long long _chunkBytes = (long long)(GridBytes(WORLD_CHUNK + 1, WORLD_CHUNK + 1) + sizeof(WORLDCHUNK) + 2 * sizeof(WORLDCHUNK*));
+	_world->chunkMax = (int)max(min(_budget / _chunkBytes, INT_MAX / 4), WORLD_WINDOW * WORLD_WINDOW);
+	int _buckets = 1;
+	while (_buckets < _world->chunkMax)
+		_buckets *= 2;
+	_world->bucketMask = _buckets - 1;
+
+	_world->chunks = (WORLDCHUNK*)calloc((size_t)_world->chunkMax, sizeof(WORLDCHUNK));
+	_world->buckets = (WORLDCHUNK**)calloc((size_t)_buckets, sizeof(WORLDCHUNK*));
+	_world->window = GridCreate(WORLD_SIDE, WORLD_SIDE);
+	if ((_world->chunks == NULL) || (_world->buckets == NULL) || (_world->window == NULL))
+	{
+		WorldRemove(_world);
+		return NULL;
+	}
+	for (; _world->chunkCount < WORLD_WINDOW * WORLD_WINDOW; _world->chunkCount += 1)
+	{
+		_world->chunks[_world->chunkCount].grid = GridCreate(WORLD_CHUNK + 1, WORLD_CHUNK + 1);
+		if (_world->chunks[_world->chunkCount].grid == NULL)
+		{
+			WorldRemove(_world);
+			return NULL;
+		}
+	}
+
+	return _world;
+}
+
+void WorldRemove(WORLD *_world)
+{
+	if (_world->chunks != NULL)
+	{
+		for (int _i = 0; _i < _world->chunkCount; _i += 1)
+			GridRemove(_world->chunks[_i].grid);
+	}
+	if (_world->window != NULL)
+		GridRemove(_world->window);
+	free(_world->chunks);
+	free(_world->buckets);
+	free(_world);
+}
+
+int WorldStart(WORLD *_world)
+{
+	WorldCompose(_world, 0, 0);
+	GRID *_grid = _world->windowChunks[WORLD_WINDOW * WORLD_WINDOW / 2]->grid;
+	return GETCELL(_world->window, WORLD_CENTER + CELLX(_grid, _world->start), WORLD_CENTER + CELLY(_grid, _world->start));
+}
+
+int WorldFollow(WORLD *_world, int _cell)
+{
+	int _x = CELLX(_world->window, _cell);
+	int _y = CELLY(_world->window, _cell);
+	int _dx = (_x >= WORLD_CENTER + WORLD_CHUNK) - (_x < WORLD_CENTER);
+	int _dy = (_y >= WORLD_CENTER + WORLD_CHUNK) - (_y < WORLD_CENTER);
+	if ((_dx == 0) && (_dy == 0))
+		return _cell;
+
+	WorldStore(_world);
+	WorldCompose(_world, _world->windowX + _dx, _world->windowY + _dy);
+	return _cell - (_dx + _dy * _world->window->width) * WORLD_CHUNK;
+}
@@ -0,0 +1,73 @@
+/**********************************************************************************************
+*
+*   world - endless maze made of chunks
+*
+*   The world is an unbounded grid of chunks, each one a GridMaze of WORLD_CHUNK + 1 cells
+*   per side generated from the world seed and its chunk coordinates. Neighbor chunks share
+*   their border walls, and the openings of every seam are hashed from the seed and the seam
+*   alone, so both chunks beside it carve the same ones in any order.
+*
+*   The player walks a window grid of WORLD_WINDOW x WORLD_WINDOW chunks composed around
+*   the chunk it stands on. When it steps into another chunk the window is written back to
+*   the chunks and composed again around the new one. Chunks far from the window are evicted
+*   least recently used first once the memory budget is spent, and generated again from the
+*   seed when the player comes back, so the memory stays the same no matter how far the
+*   player walks. Evicted chunks lose what the player changed on them.
+*
+*   LICENSE: zlib/libpng
+*
+*   Copyright (c) 2020 Jose Miguel Rodriguez Chavarri (https://github.com/txesmi/)
+*
+**********************************************************************************************/
+
+#ifndef WORLD_H
+#define WORLD_H
+
+#include "maze.h"
+
+//--------------------------------------------------------------------------------------------
+// DEFINES
+//--------------------------------------------------------------------------------------------
+
+#define WORLD_CHUNK               64 // cells per chunk side, border walls shared with the neighbors
+#define WORLD_WINDOW              3  // chunks per window side, the viewer stays in the central one
+#define WORLD_SEAM_OPENINGS       3  // passages across every chunk border
+#define WORLD_BONUS_MIN           1  // bonuses guaranteed on every chunk
+
+//--------------------------------------------------------------------------------------------
+// WORLD
+//--------------------------------------------------------------------------------------------
+
+typedef struct WORLDCHUNK
+{
+	int x; // chunk coordinates
+	int y;
+	GRID *grid;
+	unsigned long long used; // world tick of the last window holding the chunk
+	struct WORLDCHUNK *next; // next chunk of the same hash bucket
+} WORLDCHUNK;
+
+typedef struct
+{
+	unsigned long long seed;
+	WORLDCHUNK *chunks;
+	int chunkCount; // chunks holding a grid
+	int chunkMax; // chunks the memory budget allows
+	WORLDCHUNK **buckets;
+	int bucketMask;
+	unsigned long long tick;
+	GRID *window;
+	WORLDCHUNK *windowChunks[WORLD_WINDOW * WORLD_WINDOW]; // row by row
+	int windowX; // coordinates of the central chunk
+	int windowY;
+	int start; // starting cell of the chunk 0,0
+	int generated; // chunks generated, again after an eviction too
+	int evicted;
+} WORLD;
+
+WORLD *WorldCreate(unsigned long long _seed, int _budgetMB); // NULL when out of memory, the budget grows to hold a window
+void WorldRemove(WORLD *_world);
+int WorldStart(WORLD *_world); // composes the window around the chunk 0,0 and returns the starting cell of the window
+int WorldFollow(WORLD *_world, int _cell); // recenters the window when the cell left its central chunk, returns the cell in the window
+
+#endif // WORLD_H